@@ -0,0 +1,75 @@
+#ifndef PEDRONET_BENCH_ALLOCATIONS_H
+#define PEDRONET_BENCH_ALLOCATIONS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Counts the heap allocations of the whole process, so a benchmark can report
+// how many an operation costs. It replaces the global operator new and
+// delete, and is included by a single translation unit of a benchmark.
+inline std::atomic_uint64_t allocations{0};
+
+// Every form below goes through these two. They stay out of line, so GCC never
+// sees malloc() and free() matched up with new and delete, which it reports
+// as -Wmismatched-new-delete.
+[[gnu::noinline]] inline void* CountedAllocate(size_t size, size_t align) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void* ptr;
+  if (align <= alignof(std::max_align_t)) {
+    ptr = std::malloc(size);
+  } else {
+    ptr = std::aligned_alloc(align, (size + align - 1) & ~(align - 1));
+  }
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+[[gnu::noinline]] inline void CountedFree(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void* operator new(size_t size) {
+  return CountedAllocate(size, 0);
+}
+
+void* operator new[](size_t size) {
+  return CountedAllocate(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+  return CountedAllocate(size, static_cast<size_t>(align));
+}
+
+void* operator new[](size_t size, std::align_val_t align) {
+  return CountedAllocate(size, static_cast<size_t>(align));
+}
+
+void operator delete(void* ptr) noexcept { CountedFree(ptr); }
+
+void operator delete[](void* ptr) noexcept { CountedFree(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { CountedFree(ptr); }
+
+void operator delete[](void* ptr, size_t) noexcept { CountedFree(ptr); }
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+  CountedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+  CountedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+  CountedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+  CountedFree(ptr);
+}
+
+#endif  // PEDRONET_BENCH_ALLOCATIONS_H
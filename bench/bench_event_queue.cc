@@ -3,12 +3,16 @@
 #include <pedronet/eventloop.h>
 #include <pedronet/logger/logger.h>
 #include <pedronet/selector/epoller.h>
+#include <atomic>
 #include <future>
+#include <iterator>
 #include <vector>
 
 #define ANKERL_NANOBENCH_IMPLEMENT
 #include <nanobench.h>
 
+#include "allocations.h"
+
 using pedrolib::Latch;
 using pedrolib::Logger;
 using pedronet::EpollSelector;
@@ -28,16 +32,52 @@ void benchmark(EventLoop& executor, const std::string& topic, size_t thread) {
   bench.epochIterations(1);
   bench.batch(n * thread);
 
+  // The tasks capture about as much as the ones of TcpConnection::Send().
+  auto owner = std::make_shared<int>();
+  std::string message = "message";
+
+  uint64_t start = 0, end = 0;
   bench.run(fmt::format("{}-{}", topic, thread), [&] {
     Latch latch(thread * n);
+    start = allocations.load();
     for (size_t i = 0; i < thread; ++i) {
       defers.emplace_back(std::async(std::launch::async, [&] {
         for (int j = 0; j < n; ++j) {
-          executor.Schedule([&] { latch.CountDown(); });
+          executor.Schedule([&latch, owner, message] { latch.CountDown(); });
         }
       }));
     }
     latch.Await();
+    end = allocations.load();
+  });
+
+  fmt::print("{}-{}: {:.3f} allocations per task\n", topic, thread,
+             (double)(end - start) / (n * thread));
+}
+
+// A single producer scheduling its tasks through ScheduleBatch().
+void benchmark_batch(EventLoop& executor, const std::string& topic,
+                     size_t batch) {
+  const size_t n = 1000000;
+
+  ankerl::nanobench::Bench bench;
+  bench.epochs(1);
+  bench.title(topic);
+  bench.epochIterations(1);
+  bench.batch(n);
+
+  bench.run(fmt::format("{}-batch-{}", topic, batch), [&] {
+    Latch latch(n);
+    std::vector<pedronet::Task> tasks;
+    for (size_t i = 0; i < n; i += batch) {
+      for (size_t j = 0; j < batch; ++j) {
+        tasks.emplace_back([&] { latch.CountDown(); });
+      }
+      executor.ScheduleBatch(std::make_move_iterator(tasks.begin()),
+                             std::make_move_iterator(tasks.end()));
+      tasks.clear();
+    }
+    latch.Await();
   });
 }
 
@@ -47,6 +87,9 @@ void benchmark(const EventLoopOptions& options, const std::string& topic) {
   for (size_t i = 1; i <= 16; i *= 2) {
     benchmark(executor, topic, i);
   }
+  for (size_t batch : {1, 16, 256}) {
+    benchmark_batch(executor, topic, batch);
+  }
   executor.Close();
 }
 
@@ -66,5 +109,8 @@ int main() {
   options.event_queue_type = EventQueueType::kDoubleBufferQueue;
   benchmark(options, "DoubleBufferQueue");
 
+  options.event_queue_type = EventQueueType::kSpscMesh;
+  benchmark(options, "SpscMesh");
+
   return 0;
 }
\ No newline at end of file
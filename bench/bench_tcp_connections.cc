@@ -0,0 +1,232 @@
+#include <pedronet/eventloopgroup.h>
+#include <pedronet/logger/logger.h>
+#include <pedronet/tcp_client.h>
+#include <pedronet/tcp_server.h>
+#include "pedrolib/logger/logger.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdio>
+#include <thread>
+#include <utility>
+
+using namespace std::chrono_literals;
+using pedrolib::Duration;
+using pedrolib::Logger;
+using pedronet::ArrayBuffer;
+using pedronet::ChannelContext;
+using pedronet::ChannelHandlerAdaptor;
+using pedronet::EventLoopGroup;
+using pedronet::EventLoopOptions;
+using pedronet::InetAddress;
+using pedronet::Latch;
+using pedronet::SelectorType;
+using pedronet::TcpClient;
+using pedronet::TcpServer;
+using pedronet::Timestamp;
+
+// Compares the server side of the epoll and io_uring selectors with a large
+// number of mostly idle connections. A few of them keep echoing messages, the
+// throughput of those and the resident memory per connection are reported.
+// Every case runs in its own process, so the resident memory of the previous
+// ones does not leak into it.
+struct TestOptions {
+  std::string topic;
+  SelectorType selector{SelectorType::kEpoll};
+  uint16_t port{1090};
+
+  size_t threads{8};
+  size_t connections{10000};
+  size_t active{256};
+  size_t length{1 << 10};
+
+  Duration duration{Duration::Seconds(5)};
+};
+
+struct Result {
+  std::string topic;
+  Duration duration;
+
+  size_t connections{};
+  uint64_t msg_recv{};
+  size_t rss_idle{};
+};
+
+size_t ResidentBytes() {
+  size_t pages = 0, resident = 0;
+  FILE* fp = fopen("/proc/self/statm", "r");
+  if (fp != nullptr) {
+    if (fscanf(fp, "%zu %zu", &pages, &resident) != 2) {
+      resident = 0;
+    }
+    fclose(fp);
+  }
+  return resident * ::sysconf(_SC_PAGESIZE);
+}
+
+size_t RaiseFileLimit() {
+  struct rlimit limit {};
+  ::getrlimit(RLIMIT_NOFILE, &limit);
+  limit.rlim_cur = limit.rlim_max;
+  ::setrlimit(RLIMIT_NOFILE, &limit);
+  ::getrlimit(RLIMIT_NOFILE, &limit);
+  return limit.rlim_cur;
+}
+
+class EchoServerHandler : public ChannelHandlerAdaptor {
+ public:
+  explicit EchoServerHandler(ChannelContext::Ptr ctx)
+      : ChannelHandlerAdaptor(std::move(ctx)) {}
+
+  void OnRead(Timestamp now, ArrayBuffer& buffer) override {
+    auto conn = GetConnection();
+    if (conn != nullptr) {
+      conn->Send(&buffer);
+    }
+  }
+};
+
+class EchoClientHandler : public ChannelHandlerAdaptor {
+ public:
+  EchoClientHandler(ChannelContext::Ptr ctx, Latch& connect_latch,
+                    std::atomic_bool& stop, std::atomic_uint64_t& msg_recv)
+      : ChannelHandlerAdaptor(std::move(ctx)),
+        connect_latch_(connect_latch),
+        stop_(stop),
+        msg_recv_(msg_recv) {}
+
+  void OnRead(Timestamp now, ArrayBuffer& buffer) override {
+    auto conn = GetConnection();
+    if (conn == nullptr) {
+      return;
+    }
+
+    msg_recv_.fetch_add(1, std::memory_order_relaxed);
+    if (stop_.load(std::memory_order_relaxed)) {
+      buffer.Reset();
+      return;
+    }
+    conn->Send(&buffer);
+  }
+
+  void OnConnect(Timestamp now) override { connect_latch_.CountDown(); }
+
+ private:
+  Latch& connect_latch_;
+  std::atomic_bool& stop_;
+  std::atomic_uint64_t& msg_recv_;
+};
+
+void PrintResult(const Result& result) {
+  uint64_t ms = result.duration.Milliseconds();
+  double avg_msg = 1000.0 * result.msg_recv / ms;
+  double per_conn = (double)result.rss_idle / result.connections;
+  fmt::print("[{}] {:.2f} msg/s, rss {:.2f} MiB, {:.2f} KiB/conn\n",
+             result.topic, avg_msg, (double)result.rss_idle / (1 << 20),
+             per_conn / 1024);
+}
+
+// Runs in a child process which exits without tearing anything down.
+[[noreturn]] void benchmark(const TestOptions& options) {
+  Result result;
+  result.topic = fmt::format("[{}] connections:{}, active:{}, package:{} KiB",
+                             options.topic, options.connections,
+                             options.active, options.length >> 10);
+  result.connections = options.connections;
+
+  EventLoopOptions server_options;
+  server_options.selector_type = options.selector;
+  auto boss_group = EventLoopGroup::Create(1, server_options);
+  auto worker_group = EventLoopGroup::Create(options.threads, server_options);
+
+  TcpServer server;
+  server.SetGroup(boss_group, worker_group);
+  server.SetBuilder(
+      [](auto ctx) { return std::make_shared<EchoServerHandler>(ctx); });
+  server.Bind(InetAddress::Create("0.0.0.0", options.port));
+  server.Start();
+
+  // The clients always use epoll, so only the server side differs.
+  auto client_group = EventLoopGroup::Create(options.threads);
+
+  Latch connect_latch(options.connections);
+  std::atomic_bool stop{false};
+  std::atomic_uint64_t msg_recv{0};
+
+  size_t rss_start = ResidentBytes();
+
+  // Spread the connections over several loopback addresses, a single
+  // destination runs out of ephemeral ports at about 28k connections.
+  std::vector<std::shared_ptr<TcpClient>> clients(options.connections);
+  for (size_t i = 0; i < clients.size(); ++i) {
+    auto host = fmt::format("127.0.0.{}", 1 + i / 20000);
+    auto& client = clients[i];
+    client = std::make_shared<TcpClient>(
+        InetAddress::Create(host, options.port));
+    client->SetGroup(client_group);
+    client->SetBuilder([&](auto ctx) {
+      return std::make_shared<EchoClientHandler>(
+          std::move(ctx), connect_latch, stop, msg_recv);
+    });
+    client->Start();
+  }
+  connect_latch.Await();
+  result.rss_idle = ResidentBytes() - std::min(rss_start, ResidentBytes());
+
+  auto buf = std::string(options.length, 'a');
+  auto start_ts = Timestamp::Now();
+  for (size_t i = 0; i < options.active && i < clients.size(); ++i) {
+    clients[i * (clients.size() / options.active)]->Send(buf);
+  }
+  std::this_thread::sleep_for(
+      std::chrono::milliseconds(options.duration.Milliseconds()));
+  stop = true;
+  result.msg_recv = msg_recv.load();
+  result.duration = Timestamp::Now() - start_ts;
+
+  PrintResult(result);
+  fflush(stdout);
+  ::_exit(0);
+}
+
+void Run(const TestOptions& options) {
+  fflush(stdout);
+  pid_t pid = ::fork();
+  if (pid == 0) {
+    benchmark(options);
+  }
+
+  int status = 0;
+  ::waitpid(pid, &status, 0);
+}
+
+int main() {
+  pedronet::logger::SetLevel(Logger::Level::kWarn);
+  fmt::print("start benchmarking...\n");
+
+  size_t limit = RaiseFileLimit();
+
+  TestOptions options;
+  for (size_t c : {10000, 20000, 50000, 100000}) {
+    // Both ends of every connection live in this process.
+    if (2 * c + 1024 > limit) {
+      fmt::print("skip {} connections, RLIMIT_NOFILE is {}\n", c, limit);
+      continue;
+    }
+
+    TestOptions copy = options;
+    copy.connections = c;
+
+    copy.topic = "epoll";
+    copy.selector = SelectorType::kEpoll;
+    copy.port = options.port++;
+    Run(copy);
+
+    copy.topic = "io_uring";
+    copy.selector = SelectorType::kIoUring;
+    copy.port = options.port++;
+    Run(copy);
+  }
+  return 0;
+}
@@ -0,0 +1,67 @@
+#include <pedronet/coroutine.h>
+#include <pedronet/eventloopgroup.h>
+#include <pedronet/logger/logger.h>
+#include <pedronet/tcp_server.h>
+#include "pedrolib/logger/logger.h"
+
+using pedrolib::Logger;
+using pedrolib::Timestamp;
+using pedronet::ArrayBuffer;
+using pedronet::Async;
+using pedronet::ChannelContext;
+using pedronet::CoroutineHandler;
+using pedronet::Error;
+using pedronet::EventLoopGroup;
+using pedronet::EventLoopOptions;
+using pedronet::InetAddress;
+using pedronet::TcpServer;
+
+// The echo server of bench_tcp_server written as a coroutine, it serves the
+// same port so bench_tcp_client drives either of them.
+class EchoServerHandler : public CoroutineHandler {
+ public:
+  explicit EchoServerHandler(Logger& logger, ChannelContext::Ptr ctx)
+      : CoroutineHandler(std::move(ctx)), logger_(logger) {}
+
+  Async<> Serve() override {
+    while (true) {
+      ArrayBuffer* buffer = co_await Read(1);
+      if (buffer == nullptr || !co_await Write(buffer)) {
+        co_return;
+      }
+    }
+  }
+
+  void OnError(Timestamp now, Error err) override {
+    logger_.Error("peer {} error: {}", *GetConnection(), err);
+  }
+
+ private:
+  Logger& logger_;
+};
+
+int main() {
+  TcpServer server;
+  pedronet::logger::SetLevel(Logger::Level::kWarn);
+
+  Logger logger("bench");
+  logger.SetLevel(Logger::Level::kInfo);
+
+  EventLoopOptions options;
+  options.selector_type = pedronet::SelectorType::kEpoll;
+  auto boss_group = EventLoopGroup::Create(1);
+  auto worker_group = EventLoopGroup::Create(32, options);
+
+  server.SetGroup(boss_group, worker_group);
+
+  server.SetBuilder([&](auto ctx) {
+    return std::make_shared<EchoServerHandler>(logger, std::move(ctx));
+  });
+
+  server.Bind(InetAddress::Create("0.0.0.0", 1082));
+  server.Start();
+
+  EventLoopGroup::Joins(boss_group, worker_group);
+
+  return 0;
+}
@@ -0,0 +1,250 @@
+#include <pedronet/eventloopgroup.h>
+#include <pedronet/logger/logger.h>
+#include <pedronet/tcp_client.h>
+#include <pedronet/tcp_server.h>
+#include "pedrolib/logger/logger.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+using namespace std::chrono_literals;
+using pedrolib::Duration;
+using pedrolib::Logger;
+using pedronet::ArrayBuffer;
+using pedronet::ChannelContext;
+using pedronet::ChannelHandlerAdaptor;
+using pedronet::EventLoopGroup;
+using pedronet::EventLoopOptions;
+using pedronet::InetAddress;
+using pedronet::Latch;
+using pedronet::TcpClient;
+using pedronet::TaskBudget;
+using pedronet::TaskPriority;
+using pedronet::TcpServer;
+using pedronet::Timestamp;
+
+// Ping-pong round trip latency of small messages with blocking event loops
+// and with busy polling ones. Every client keeps a single message in flight,
+// so each round trip pays for the wakeups of both loops. The bulk cases keep
+// the server loops busy with background tasks, with and without a budget.
+struct TestOptions {
+  std::string topic;
+  Duration busy_poll{Duration::Zero()};
+  uint16_t port{1110};
+
+  bool bulk{false};
+  TaskBudget background_budget{};
+
+  size_t threads{1};
+  size_t clients{1};
+  size_t length{64};
+
+  Duration duration{Duration::Seconds(5)};
+};
+
+// Round trip times in nanoseconds.
+class Samples {
+ public:
+  void Add(int64_t rtt) {
+    std::unique_lock lock(mu_);
+    samples_.emplace_back(rtt);
+  }
+
+  std::vector<int64_t> Take() {
+    std::unique_lock lock(mu_);
+    return std::move(samples_);
+  }
+
+ private:
+  std::mutex mu_;
+  std::vector<int64_t> samples_;
+};
+
+class EchoServerHandler : public ChannelHandlerAdaptor {
+ public:
+  explicit EchoServerHandler(ChannelContext::Ptr ctx)
+      : ChannelHandlerAdaptor(std::move(ctx)) {}
+
+  void OnRead(Timestamp now, ArrayBuffer& buffer) override {
+    auto conn = GetConnection();
+    if (conn != nullptr) {
+      conn->Send(&buffer);
+    }
+  }
+};
+
+class PingClientHandler : public ChannelHandlerAdaptor {
+  using Clock = std::chrono::steady_clock;
+
+ public:
+  PingClientHandler(ChannelContext::Ptr ctx, Latch& connect_latch,
+                    std::atomic_bool& stop, Samples& samples, size_t length)
+      : ChannelHandlerAdaptor(std::move(ctx)),
+        connect_latch_(connect_latch),
+        stop_(stop),
+        samples_(samples),
+        message_(length, 'a') {}
+
+  void OnRead(Timestamp now, ArrayBuffer& buffer) override {
+    auto conn = GetConnection();
+    if (conn == nullptr || buffer.ReadableBytes() < message_.size()) {
+      return;
+    }
+    buffer.Retrieve(message_.size());
+
+    auto ts = Clock::now();
+    // The first message was sent by another thread, skip it.
+    if (warm_) {
+      samples_.Add(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(ts - sent_)
+              .count());
+    }
+    warm_ = true;
+
+    if (stop_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    sent_ = Clock::now();
+    conn->Send(std::string_view{message_});
+  }
+
+  void OnConnect(Timestamp now) override { connect_latch_.CountDown(); }
+
+ private:
+  Latch& connect_latch_;
+  std::atomic_bool& stop_;
+  Samples& samples_;
+  std::string message_;
+
+  bool warm_{};
+  Clock::time_point sent_;
+};
+
+double Percentile(const std::vector<int64_t>& sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  auto index = std::min((size_t)(p * sorted.size()), sorted.size() - 1);
+  return sorted[index] / 1000.0;
+}
+
+// Runs in a child process which exits without tearing anything down.
+[[noreturn]] void benchmark(const TestOptions& options) {
+  // Both ends busy poll, SO_BUSY_POLL is left alone since the loopback device
+  // has no queue to poll.
+  EventLoopOptions loop_options;
+  loop_options.busy_poll = options.busy_poll;
+
+  EventLoopOptions worker_options = loop_options;
+  worker_options.background_budget = options.background_budget;
+
+  auto boss_group = EventLoopGroup::Create(1, loop_options);
+  auto worker_group = EventLoopGroup::Create(options.threads, worker_options);
+  auto client_group = EventLoopGroup::Create(options.threads, loop_options);
+
+  TcpServer server;
+  server.SetGroup(boss_group, worker_group);
+  server.SetBuilder(
+      [](auto ctx) { return std::make_shared<EchoServerHandler>(ctx); });
+  server.Bind(InetAddress::Create("0.0.0.0", options.port));
+  server.Start();
+
+  Latch connect_latch(options.clients);
+  std::atomic_bool stop{false};
+  Samples samples;
+
+  std::vector<std::shared_ptr<TcpClient>> clients(options.clients);
+  for (auto& client : clients) {
+    client = std::make_shared<TcpClient>(
+        InetAddress::Create("127.0.0.1", options.port));
+    client->SetGroup(client_group);
+    client->SetBuilder([&](auto ctx) {
+      return std::make_shared<PingClientHandler>(
+          std::move(ctx), connect_latch, stop, samples, options.length);
+    });
+    client->Start();
+  }
+  connect_latch.Await();
+
+  // About a millisecond of 2us tasks every millisecond.
+  std::thread bulk([&] {
+    while (options.bulk && !stop) {
+      for (size_t i = 0; i < 500; ++i) {
+        worker_group->Schedule(TaskPriority::kBackground, [] {
+          auto until = std::chrono::steady_clock::now() + 2us;
+          while (std::chrono::steady_clock::now() < until) {
+          }
+        });
+      }
+      std::this_thread::sleep_for(1ms);
+    }
+  });
+
+  auto buf = std::string(options.length, 'a');
+  for (auto& client : clients) {
+    client->Send(buf);
+  }
+  std::this_thread::sleep_for(
+      std::chrono::milliseconds(options.duration.Milliseconds()));
+  stop = true;
+  bulk.join();
+
+  auto rtt = samples.Take();
+  std::sort(rtt.begin(), rtt.end());
+  fmt::print("[[{}] client:{}] {} rtt, p50 {:.2f}us, p99 {:.2f}us, "
+             "p999 {:.2f}us\n",
+             options.topic, options.clients, rtt.size(), Percentile(rtt, 0.5),
+             Percentile(rtt, 0.99), Percentile(rtt, 0.999));
+  fflush(stdout);
+  ::_exit(0);
+}
+
+void Run(const TestOptions& options) {
+  fflush(stdout);
+  pid_t pid = ::fork();
+  if (pid == 0) {
+    benchmark(options);
+  }
+
+  int status = 0;
+  ::waitpid(pid, &status, 0);
+}
+
+int main() {
+  pedronet::logger::SetLevel(Logger::Level::kWarn);
+  fmt::print("start benchmarking...\n");
+
+  TestOptions options;
+  for (size_t c : {1, 8}) {
+    TestOptions copy = options;
+    copy.clients = c;
+
+    copy.topic = "blocking";
+    copy.busy_poll = Duration::Zero();
+    copy.port = options.port++;
+    Run(copy);
+
+    copy.topic = "busy-poll";
+    copy.busy_poll = Duration::Microseconds(200);
+    copy.port = options.port++;
+    Run(copy);
+
+    copy.topic = "bulk";
+    copy.busy_poll = Duration::Zero();
+    copy.bulk = true;
+    copy.port = options.port++;
+    Run(copy);
+
+    copy.topic = "bulk-budget";
+    copy.background_budget.time = Duration::Microseconds(100);
+    copy.port = options.port++;
+    Run(copy);
+  }
+  return 0;
+}
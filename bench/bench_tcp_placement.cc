@@ -0,0 +1,237 @@
+#include <pedronet/eventloopgroup.h>
+#include <pedronet/logger/logger.h>
+#include <pedronet/tcp_client.h>
+#include <pedronet/tcp_server.h>
+#include "pedrolib/logger/logger.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+using namespace std::chrono_literals;
+using pedrolib::Duration;
+using pedrolib::Logger;
+using pedronet::ArrayBuffer;
+using pedronet::ChannelContext;
+using pedronet::ChannelHandlerAdaptor;
+using pedronet::EventLoop;
+using pedronet::EventLoopGroup;
+using pedronet::InetAddress;
+using pedronet::Latch;
+using pedronet::PlacementPolicy;
+using pedronet::TcpClient;
+using pedronet::TcpServer;
+using pedronet::TcpServerOptions;
+using pedronet::Timestamp;
+
+// Places a few heavy, long-lived echo connections among short-lived light
+// ones. Every heavy connection is followed by `light` connections which
+// close right away, so round robin keeps putting the heavy ones onto the
+// same loop. Reports the heavy connections and the echo throughput of every
+// server loop.
+struct TestOptions {
+  std::string topic;
+  PlacementPolicy policy{PlacementPolicy::kRoundRobin};
+  uint16_t port{1130};
+
+  size_t threads{4};
+  size_t heavy{4};
+  size_t light{3};
+  size_t length{16 << 10};
+
+  Duration duration{Duration::Seconds(3)};
+};
+
+// Bytes echoed by every server loop.
+class LoopLoads {
+ public:
+  explicit LoopLoads(std::vector<EventLoop*> loops)
+      : loops_(std::move(loops)) {
+    for (size_t i = 0; i < loops_.size(); ++i) {
+      index_[loops_[i]] = i;
+    }
+  }
+
+  std::atomic_uint64_t& Get(EventLoop* loop) {
+    return bytes_[index_.at(loop)];
+  }
+
+  const std::vector<EventLoop*>& Loops() const { return loops_; }
+
+  uint64_t Bytes(size_t i) const { return bytes_[i].load(); }
+
+ private:
+  std::vector<EventLoop*> loops_;
+  std::unordered_map<EventLoop*, size_t> index_;
+  std::array<std::atomic_uint64_t, 64> bytes_{};
+};
+
+class EchoServerHandler : public ChannelHandlerAdaptor {
+ public:
+  EchoServerHandler(ChannelContext::Ptr ctx, LoopLoads& loads)
+      : ChannelHandlerAdaptor(std::move(ctx)), loads_(loads) {}
+
+  void OnConnect(Timestamp now) override {
+    bytes_ = &loads_.Get(EventLoop::GetEventLoop());
+  }
+
+  void OnRead(Timestamp now, ArrayBuffer& buffer) override {
+    auto conn = GetConnection();
+    if (conn != nullptr) {
+      bytes_->fetch_add(buffer.ReadableBytes(), std::memory_order_relaxed);
+      conn->Send(&buffer);
+    }
+  }
+
+ private:
+  LoopLoads& loads_;
+  std::atomic_uint64_t* bytes_{};
+};
+
+class EchoClientHandler : public ChannelHandlerAdaptor {
+ public:
+  EchoClientHandler(ChannelContext::Ptr ctx, Latch& connect_latch,
+                    std::atomic_bool& stop)
+      : ChannelHandlerAdaptor(std::move(ctx)),
+        connect_latch_(connect_latch),
+        stop_(stop) {}
+
+  void OnRead(Timestamp now, ArrayBuffer& buffer) override {
+    auto conn = GetConnection();
+    if (conn == nullptr || stop_.load(std::memory_order_relaxed)) {
+      buffer.Reset();
+      return;
+    }
+    conn->Send(&buffer);
+  }
+
+  void OnConnect(Timestamp now) override { connect_latch_.CountDown(); }
+
+ private:
+  Latch& connect_latch_;
+  std::atomic_bool& stop_;
+};
+
+std::shared_ptr<TcpClient> Connect(const TestOptions& options,
+                                   const EventLoopGroup::Ptr& group,
+                                   std::atomic_bool& stop) {
+  Latch latch(1);
+  auto client = std::make_shared<TcpClient>(
+      InetAddress::Create("127.0.0.1", options.port));
+  client->SetGroup(group);
+  client->SetBuilder([&](auto ctx) {
+    return std::make_shared<EchoClientHandler>(std::move(ctx), latch, stop);
+  });
+  client->Start();
+  latch.Await();
+  return client;
+}
+
+// Runs in a child process which exits without tearing anything down.
+[[noreturn]] void benchmark(const TestOptions& options) {
+  auto boss_group = EventLoopGroup::Create(1);
+  auto worker_group = EventLoopGroup::Create(options.threads);
+  auto client_group = EventLoopGroup::Create(1);
+
+  std::vector<EventLoop*> loops;
+  for (size_t i = 0; i < options.threads; ++i) {
+    loops.emplace_back(&worker_group->Next());
+  }
+  LoopLoads loads(std::move(loops));
+
+  TcpServerOptions server_options;
+  server_options.placement = options.policy;
+
+  TcpServer server;
+  server.SetOptions(server_options);
+  server.SetGroup(boss_group, worker_group);
+  server.SetBuilder([&](auto ctx) {
+    return std::make_shared<EchoServerHandler>(std::move(ctx), loads);
+  });
+  server.Bind(InetAddress::Create("0.0.0.0", options.port));
+  server.Start();
+
+  std::atomic_bool stop{false};
+  std::vector<std::shared_ptr<TcpClient>> heavy;
+  for (size_t i = 0; i < options.heavy; ++i) {
+    heavy.emplace_back(Connect(options, client_group, stop));
+
+    std::vector<std::shared_ptr<TcpClient>> light;
+    for (size_t j = 0; j < options.light; ++j) {
+      light.emplace_back(Connect(options, client_group, stop));
+    }
+    for (auto& client : light) {
+      client->Close();
+    }
+    // Let the server side of the light connections go away.
+    std::this_thread::sleep_for(100ms);
+  }
+
+  auto buf = std::string(options.length, 'a');
+  for (auto& client : heavy) {
+    client->Send(buf);
+  }
+  auto start_ts = Timestamp::Now();
+  std::this_thread::sleep_for(
+      std::chrono::milliseconds(options.duration.Milliseconds()));
+  stop = true;
+  double seconds = (Timestamp::Now() - start_ts).Milliseconds() / 1000.0;
+
+  std::string conns;
+  std::string rates;
+  double total = 0;
+  double max = 0;
+  for (size_t i = 0; i < loads.Loops().size(); ++i) {
+    double rate = loads.Bytes(i) / seconds / (1 << 20);
+    total += rate;
+    max = std::max(max, rate);
+
+    const char* sep = i == 0 ? "" : ", ";
+    conns += fmt::format("{}{}", sep, loads.Loops()[i]->GetConnections());
+    rates += fmt::format("{}{:.1f}", sep, rate);
+  }
+  double mean = total / loads.Loops().size();
+
+  fmt::print("[{}] heavy conns per loop [{}], MiB/s per loop [{}], "
+             "max/mean {:.2f}\n",
+             options.topic, conns, rates, mean == 0 ? 0 : max / mean);
+  fflush(stdout);
+  ::_exit(0);
+}
+
+void Run(const TestOptions& options) {
+  fflush(stdout);
+  pid_t pid = ::fork();
+  if (pid == 0) {
+    benchmark(options);
+  }
+
+  int status = 0;
+  ::waitpid(pid, &status, 0);
+}
+
+int main() {
+  pedronet::logger::SetLevel(Logger::Level::kWarn);
+  fmt::print("start benchmarking...\n");
+
+  TestOptions options;
+  std::pair<const char*, PlacementPolicy> policies[] = {
+      {"round-robin", PlacementPolicy::kRoundRobin},
+      {"least-connections", PlacementPolicy::kLeastConnections},
+      {"least-queue-depth", PlacementPolicy::kLeastQueueDepth},
+      {"power-of-two-choices", PlacementPolicy::kPowerOfTwoChoices},
+  };
+  for (auto [topic, policy] : policies) {
+    TestOptions copy = options;
+    copy.topic = topic;
+    copy.policy = policy;
+    copy.port = options.port++;
+    Run(copy);
+  }
+  return 0;
+}
@@ -0,0 +1,243 @@
+#include <pedronet/eventloopgroup.h>
+#include <pedronet/logger/logger.h>
+#include <pedronet/tcp_client.h>
+#include <pedronet/tcp_server.h>
+#include "pedrolib/logger/logger.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+
+using namespace std::chrono_literals;
+using pedrolib::Duration;
+using pedrolib::Logger;
+using pedronet::ArrayBuffer;
+using pedronet::ChannelContext;
+using pedronet::ChannelHandlerAdaptor;
+using pedronet::EventLoopGroup;
+using pedronet::InetAddress;
+using pedronet::Latch;
+using pedronet::Selector;
+using pedronet::SelectTrigger;
+using pedronet::TcpClient;
+using pedronet::TcpClientOptions;
+using pedronet::TcpServer;
+using pedronet::TcpServerOptions;
+using pedronet::Timestamp;
+
+// Bulk echo transfer with level-triggered and edge-triggered connections on
+// both ends. Large packages make most writes partial, which is where the
+// level-triggered mode toggles the write interest in the selector. The
+// interest changes handed to the kernel are reported per received message.
+struct TestOptions {
+  std::string topic;
+  SelectTrigger trigger{SelectTrigger::kLevel};
+  uint16_t port{1100};
+
+  size_t threads{4};
+  size_t clients{16};
+  size_t length{1 << 20};
+
+  Duration duration{Duration::Seconds(5)};
+};
+
+struct Result {
+  std::string topic;
+  Duration duration;
+  uint64_t byte_recv{};
+  uint64_t msg_recv{};
+  uint64_t updates{};
+};
+
+// The selectors of all the event loops the connections are running in.
+class SelectorSet {
+ public:
+  void Add(Selector* selector) {
+    std::unique_lock lock(mu_);
+    selectors_.emplace(selector);
+  }
+
+  uint64_t Updates() {
+    std::unique_lock lock(mu_);
+    uint64_t updates = 0;
+    for (Selector* selector : selectors_) {
+      updates += selector->Updates();
+    }
+    return updates;
+  }
+
+ private:
+  std::mutex mu_;
+  std::unordered_set<Selector*> selectors_;
+};
+
+class EchoServerHandler : public ChannelHandlerAdaptor {
+ public:
+  EchoServerHandler(ChannelContext::Ptr ctx, SelectorSet& selectors)
+      : ChannelHandlerAdaptor(std::move(ctx)), selectors_(selectors) {}
+
+  void OnRead(Timestamp now, ArrayBuffer& buffer) override {
+    auto conn = GetConnection();
+    if (conn != nullptr) {
+      conn->Send(&buffer);
+    }
+  }
+
+  void OnConnect(Timestamp now) override {
+    auto conn = GetConnection();
+    if (conn != nullptr) {
+      selectors_.Add(conn->GetEventLoop().GetSelector());
+    }
+  }
+
+ private:
+  SelectorSet& selectors_;
+};
+
+class EchoClientHandler : public ChannelHandlerAdaptor {
+ public:
+  EchoClientHandler(ChannelContext::Ptr ctx, Latch& connect_latch,
+                    SelectorSet& selectors, std::atomic_uint64_t& byte_recv,
+                    std::atomic_uint64_t& msg_recv)
+      : ChannelHandlerAdaptor(std::move(ctx)),
+        connect_latch_(connect_latch),
+        selectors_(selectors),
+        byte_recv_(byte_recv),
+        msg_recv_(msg_recv) {}
+
+  void OnRead(Timestamp now, ArrayBuffer& buffer) override {
+    auto conn = GetConnection();
+    if (conn == nullptr) {
+      return;
+    }
+    byte_recv_.fetch_add(buffer.ReadableBytes(), std::memory_order_relaxed);
+    msg_recv_.fetch_add(1, std::memory_order_relaxed);
+    conn->Send(&buffer);
+  }
+
+  void OnConnect(Timestamp now) override {
+    auto conn = GetConnection();
+    if (conn != nullptr) {
+      selectors_.Add(conn->GetEventLoop().GetSelector());
+    }
+    connect_latch_.CountDown();
+  }
+
+ private:
+  Latch& connect_latch_;
+  SelectorSet& selectors_;
+  std::atomic_uint64_t& byte_recv_;
+  std::atomic_uint64_t& msg_recv_;
+};
+
+void PrintResult(const Result& result) {
+  uint64_t ms = result.duration.Milliseconds();
+  double avg_byte = 1000.0 * result.byte_recv / ms;
+  uint64_t msg = std::max<uint64_t>(result.msg_recv, 1);
+  double per_msg = (double)result.updates / msg;
+  fmt::print("[{}] {:.2f} MiB/s, {:.3f} ctl/msg\n", result.topic,
+             avg_byte / (1 << 20), per_msg);
+}
+
+// Runs in a child process which exits without tearing anything down.
+[[noreturn]] void benchmark(const TestOptions& options) {
+  Result result;
+  result.topic = fmt::format("[{}] client:{}, package:{} KiB", options.topic,
+                             options.clients, options.length >> 10);
+
+  auto boss_group = EventLoopGroup::Create(1);
+  auto worker_group = EventLoopGroup::Create(options.threads);
+  auto client_group = EventLoopGroup::Create(options.threads);
+
+  TcpServerOptions server_options;
+  server_options.child_options.trigger = options.trigger;
+
+  TcpServer server;
+  server.SetOptions(server_options);
+  server.SetGroup(boss_group, worker_group);
+  SelectorSet selectors;
+  server.SetBuilder([&](auto ctx) {
+    return std::make_shared<EchoServerHandler>(std::move(ctx), selectors);
+  });
+  server.Bind(InetAddress::Create("0.0.0.0", options.port));
+  server.Start();
+
+  TcpClientOptions client_options;
+  client_options.options.trigger = options.trigger;
+
+  Latch connect_latch(options.clients);
+  std::atomic_uint64_t byte_recv{0};
+  std::atomic_uint64_t msg_recv{0};
+
+  std::vector<std::shared_ptr<TcpClient>> clients(options.clients);
+  for (auto& client : clients) {
+    client = std::make_shared<TcpClient>(
+        InetAddress::Create("127.0.0.1", options.port));
+    client->SetOptions(client_options);
+    client->SetGroup(client_group);
+    client->SetBuilder([&](auto ctx) {
+      return std::make_shared<EchoClientHandler>(
+          std::move(ctx), connect_latch, selectors, byte_recv, msg_recv);
+    });
+    client->Start();
+  }
+  connect_latch.Await();
+
+  auto buf = std::string(options.length, 'a');
+  auto start_ts = Timestamp::Now();
+  uint64_t updates = selectors.Updates();
+  for (auto& client : clients) {
+    client->Send(buf);
+  }
+  std::this_thread::sleep_for(
+      std::chrono::milliseconds(options.duration.Milliseconds()));
+  result.byte_recv = byte_recv.load();
+  result.msg_recv = msg_recv.load();
+  result.updates = selectors.Updates() - updates;
+  result.duration = Timestamp::Now() - start_ts;
+
+  PrintResult(result);
+  fflush(stdout);
+  ::_exit(0);
+}
+
+void Run(const TestOptions& options) {
+  fflush(stdout);
+  pid_t pid = ::fork();
+  if (pid == 0) {
+    benchmark(options);
+  }
+
+  int status = 0;
+  ::waitpid(pid, &status, 0);
+}
+
+int main() {
+  pedronet::logger::SetLevel(Logger::Level::kWarn);
+  fmt::print("start benchmarking...\n");
+
+  TestOptions options;
+  for (size_t length : {64 << 10, 1 << 20, 8 << 20}) {
+    for (size_t c : {1, 16, 64}) {
+      TestOptions copy = options;
+      copy.clients = c;
+      copy.length = length;
+
+      copy.topic = "level";
+      copy.trigger = SelectTrigger::kLevel;
+      copy.port = options.port++;
+      Run(copy);
+
+      copy.topic = "edge";
+      copy.trigger = SelectTrigger::kEdge;
+      copy.port = options.port++;
+      Run(copy);
+    }
+  }
+  return 0;
+}
@@ -3,11 +3,15 @@
 #include <pedronet/eventloop.h>
 #include <pedronet/logger/logger.h>
 #include <pedronet/selector/epoller.h>
+#include <atomic>
 #include <future>
+#include <vector>
 
 #define ANKERL_NANOBENCH_IMPLEMENT
 #include <nanobench.h>
 
+#include "allocations.h"
+
 using pedrolib::Latch;
 using pedrolib::Logger;
 using pedronet::Duration;
@@ -17,6 +21,16 @@ using pedronet::EventLoopOptions;
 using pedronet::EventQueueType;
 using pedronet::TimerQueueType;
 
+// Runs one benchmark of ops operations and reports its allocations per op.
+template <typename Op>
+void run(ankerl::nanobench::Bench& bench, const std::string& name, size_t ops,
+         Op&& op) {
+  uint64_t before = allocations.load();
+  bench.run(name, std::forward<Op>(op));
+  fmt::print("{}: {:.3f} allocations/op\n", name,
+             static_cast<double>(allocations.load() - before) / ops);
+}
+
 template <typename Generator>
 void benchmark(const EventLoopOptions& options, const std::string& topic,
                ankerl::nanobench::Bench& bench, Generator&& generator) {
@@ -24,7 +38,7 @@ void benchmark(const EventLoopOptions& options, const std::string& topic,
   auto defer = std::async(std::launch::async, [&] { executor.Loop(); });
 
   std::atomic_size_t counter = 0;
-  bench.run(topic, [&] {
+  run(bench, topic, bench.epochIterations(), [&] {
     executor.ScheduleAfter(Duration::Milliseconds(generator()),
                            [&] { counter++; });
   });
@@ -62,6 +76,80 @@ void benchmark(const EventLoopOptions& options, const std::string& topic) {
   });
 }
 
+// Keeps n timers due in 1s to 3h outstanding, then cancels all of them. Both
+// run on the loop, like per-request timeouts do.
+void outstanding(const EventLoopOptions& options, const std::string& topic) {
+  const size_t n = 10000000;
+
+  EventLoop executor(options);
+  auto defer = std::async(std::launch::async, [&] { executor.Loop(); });
+
+  ankerl::nanobench::Bench bench;
+  bench.epochs(1);
+  bench.title(topic);
+  bench.epochIterations(1);
+  bench.batch(n);
+
+  std::vector<uint64_t> ids(n);
+  std::mt19937_64 rnd(time(nullptr));
+  std::uniform_int_distribution<int64_t> dist(1000, 3 * 3600 * 1000);
+  run(bench, "Outstanding(1s, 3h) Add", n, [&] {
+    Latch latch(1);
+    executor.Schedule([&] {
+      for (auto& id : ids) {
+        id = executor.ScheduleAfter(Duration::Milliseconds(dist(rnd)), [] {});
+      }
+      latch.CountDown();
+    });
+    latch.Await();
+  });
+
+  run(bench, "Outstanding(1s, 3h) Cancel", n, [&] {
+    Latch latch(1);
+    executor.Schedule([&] {
+      for (uint64_t id : ids) {
+        executor.ScheduleCancel(id);
+      }
+      latch.CountDown();
+    });
+    latch.Await();
+  });
+  executor.Close();
+}
+
+// RPC style timeouts: a window of them is outstanding and every one is
+// cancelled before it fires.
+void cancel_heavy(const EventLoopOptions& options, const std::string& topic) {
+  const size_t n = 10000000;
+  const size_t window = 4096;
+
+  EventLoop executor(options);
+  auto defer = std::async(std::launch::async, [&] { executor.Loop(); });
+
+  ankerl::nanobench::Bench bench;
+  bench.epochs(1);
+  bench.title(topic);
+  bench.epochIterations(1);
+  bench.batch(n);
+
+  std::vector<uint64_t> ids(window);
+  run(bench, "CancelHeavy(5s, window 4096)", n, [&] {
+    Latch latch(1);
+    executor.Schedule([&] {
+      for (size_t i = 0; i < n; ++i) {
+        uint64_t& id = ids[i % window];
+        if (id != 0) {
+          executor.ScheduleCancel(id);
+        }
+        id = executor.ScheduleAfter(Duration::Seconds(5), [] {});
+      }
+      latch.CountDown();
+    });
+    latch.Await();
+  });
+  executor.Close();
+}
+
 int main() {
   pedronet::logger::SetLevel(Logger::Level::kTrace);
 
@@ -76,5 +164,26 @@ int main() {
   options.timer_queue_type = TimerQueueType::kHashWheel;
   benchmark(options, "HashTimeWheel");
 
+  options.timer_queue_type = TimerQueueType::kHierarchicalWheel;
+  benchmark(options, "HierarchicalWheel");
+
+  options.timer_queue_type = TimerQueueType::kHeap;
+  outstanding(options, "HeapQueue");
+
+  options.timer_queue_type = TimerQueueType::kHashWheel;
+  outstanding(options, "HashTimeWheel");
+
+  options.timer_queue_type = TimerQueueType::kHierarchicalWheel;
+  outstanding(options, "HierarchicalWheel");
+
+  options.timer_queue_type = TimerQueueType::kHeap;
+  cancel_heavy(options, "HeapQueue");
+
+  options.timer_queue_type = TimerQueueType::kHashWheel;
+  cancel_heavy(options, "HashTimeWheel");
+
+  options.timer_queue_type = TimerQueueType::kHierarchicalWheel;
+  cancel_heavy(options, "HierarchicalWheel");
+
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include <pedrolib/concurrent/latch.h>
+#include <pedrolib/logger/logger.h>
+#include <pedronet/eventloopgroup.h>
+#include <pedronet/logger/logger.h>
+
+#include <sys/resource.h>
+#include <atomic>
+#include <random>
+#include <thread>
+
+using namespace std::chrono_literals;
+using pedrolib::Latch;
+using pedrolib::Logger;
+using pedronet::Duration;
+using pedronet::EventLoop;
+using pedronet::EventLoopGroup;
+using pedronet::EventLoopOptions;
+using pedronet::TimerQueueType;
+using pedronet::Timestamp;
+
+// Voluntary context switches of the process, every time the loop blocks in
+// the selector and is woken up again counts as one.
+static long Switches() {
+  struct rusage usage {};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_nvcsw;
+}
+
+// The keepalive timers of 100k idle connections: every 1s with random
+// phases, all on one loop. Reports how often the loop wakes up for them.
+void benchmark(TimerQueueType type, const std::string& topic,
+               Duration slack) {
+  const size_t connections = 100000;
+
+  EventLoopOptions options;
+  options.timer_queue_type = type;
+  auto group = EventLoopGroup::Create(1, options);
+  EventLoop& loop = group->Next();
+
+  std::atomic_size_t fired = 0;
+  Latch latch(1);
+  loop.Schedule([&] {
+    std::mt19937_64 rnd(42);
+    std::uniform_int_distribution<int64_t> phase(0, 999999);
+    for (size_t i = 0; i < connections; ++i) {
+      loop.ScheduleEvery(Duration::Microseconds(phase(rnd)),
+                         Duration::Seconds(1), slack, [&] {
+                           fired.fetch_add(1, std::memory_order_relaxed);
+                         });
+    }
+    latch.CountDown();
+  });
+  latch.Await();
+  std::this_thread::sleep_for(1s);
+
+#ifdef PEDRONET_METRICS
+  auto before = loop.GetMetrics();
+#endif
+  long switches = Switches();
+  size_t n = fired.load();
+  Timestamp start = Timestamp::Now();
+  std::this_thread::sleep_for(5s);
+
+  double seconds = (Timestamp::Now() - start).Microseconds() / 1e6;
+  fmt::print("{} slack={}ms: {:.0f} wakeups/s, {:.0f} timers/s\n", topic,
+             slack.Milliseconds(), (Switches() - switches) / seconds,
+             (fired.load() - n) / seconds);
+#ifdef PEDRONET_METRICS
+  auto after = loop.GetMetrics();
+  fmt::print("  {:.0f} loop iterations/s, timer lag p99 {}us\n",
+             (after.wait_ns.count - before.wait_ns.count) / seconds,
+             after.timer_lag_us.Percentile(0.99));
+#endif
+  group->Close();
+}
+
+int main() {
+  pedronet::logger::SetLevel(Logger::Level::kWarn);
+
+  for (int64_t ms : {0, 10, 100, 250}) {
+    benchmark(TimerQueueType::kHeap, "HeapQueue", Duration::Milliseconds(ms));
+  }
+  for (int64_t ms : {0, 10, 100, 250}) {
+    benchmark(TimerQueueType::kHierarchicalWheel, "HierarchicalWheel",
+              Duration::Milliseconds(ms));
+  }
+  return 0;
+}
@@ -0,0 +1,89 @@
+#include <pedrolib/concurrent/latch.h>
+#include <pedrolib/logger/logger.h>
+#include <pedronet/eventloopgroup.h>
+#include <pedronet/logger/logger.h>
+#include <pedronet/worker_pool.h>
+#include <functional>
+
+#define ANKERL_NANOBENCH_IMPLEMENT
+#include <nanobench.h>
+
+using pedrolib::Latch;
+using pedrolib::Logger;
+using pedronet::EventLoop;
+using pedronet::EventLoopGroup;
+using pedronet::WorkerPool;
+
+// Stands for a small piece of blocking work.
+static uint64_t Work(uint64_t seed) {
+  for (int i = 0; i < 64; ++i) {
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+  }
+  return seed;
+}
+
+// A loop keeps `window` pieces of work in flight until n are done, every
+// continuation offloads the next one. The continuations are delivered by
+// Submit(), or scheduled onto the loop one by one.
+void benchmark(WorkerPool& pool, EventLoop& loop, const std::string& topic,
+               bool batched) {
+  const size_t n = 1000000;
+  const size_t window = 256;
+
+  ankerl::nanobench::Bench bench;
+  bench.epochs(1);
+  bench.title(topic);
+  bench.epochIterations(1);
+  bench.batch(n);
+
+#ifdef PEDRONET_METRICS
+  auto before = loop.GetMetrics();
+#endif
+  bench.run(topic, [&] {
+    Latch latch(n);
+    size_t issued = 0;
+    std::function<void()> offload = [&] {
+      uint64_t seed = issued++;
+      auto then = [&] {
+        latch.CountDown();
+        if (issued < n) {
+          offload();
+        }
+      };
+      if (batched) {
+        pool.Submit([seed] { Work(seed); }, then);
+      } else {
+        pool.Schedule([&, seed, then] {
+          Work(seed);
+          loop.Schedule(then);
+        });
+      }
+    };
+    loop.Schedule([&] {
+      for (size_t i = 0; i < window; ++i) {
+        offload();
+      }
+    });
+    latch.Await();
+  });
+
+#ifdef PEDRONET_METRICS
+  auto after = loop.GetMetrics();
+  fmt::print("{}: {:.4f} loop tasks per continuation\n", topic,
+             (double)(after.tasks.sum - before.tasks.sum) / n);
+#endif
+}
+
+int main() {
+  pedronet::logger::SetLevel(Logger::Level::kWarn);
+
+  auto group = EventLoopGroup::Create(1);
+  for (size_t threads : {1, 4, 16}) {
+    auto pool = WorkerPool::Create(threads);
+    EventLoop& loop = group->Next();
+    benchmark(*pool, loop, fmt::format("schedule-{}", threads), false);
+    benchmark(*pool, loop, fmt::format("submit-{}", threads), true);
+  }
+  group->Close();
+  return 0;
+}
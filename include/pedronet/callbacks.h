@@ -12,9 +12,12 @@ class TcpConnection;
 class ReceiveEvents;
 class SelectEvents;
 class Channel;
+struct SelectCompletion;
 
 using Callback = std::function<void()>;
 using SelectorCallback = std::function<void(ReceiveEvents events, Timestamp)>;
+using CompletionCallback =
+    std::function<void(const SelectCompletion& completion, Timestamp)>;
 
 }  // namespace pedronet
 
@@ -20,6 +20,8 @@ struct Channel : pedrolib::noncopyable, pedrolib::nonmovable {
   virtual File& GetFile() noexcept = 0;
   [[nodiscard]] virtual const File& GetFile() const noexcept = 0;
   virtual void HandleEvents(ReceiveEvents events, Timestamp now) = 0;
+  virtual void HandleCompletion(const SelectCompletion& completion,
+                                Timestamp now) {}
   [[nodiscard]] virtual std::string String() const = 0;
   virtual ~Channel() = default;
 };
@@ -23,10 +23,15 @@ class EventChannel final : public Channel {
 
   [[nodiscard]] std::string String() const override;
 
+  // Published by the event loop around Selector::Wait(). While the loop is
+  // awake it drains the event queue by itself, so WakeUp() skips the eventfd.
+  void SetSleeping(bool sleeping) noexcept { sleeping_.store(sleeping); }
+
   void WakeUp();
 
  private:
   Callback event_callback_;
+  std::atomic_bool sleeping_{};
   File file_;
 };
 }  // namespace pedronet
@@ -15,14 +15,19 @@ struct Selector;
 class SocketChannel final : public Socket, public Channel {
  protected:
   SelectEvents events_{SelectEvents::kNoneEvent};
+  SelectTrigger trigger_{SelectTrigger::kLevel};
 
   SelectorCallback close_callback_;
   SelectorCallback read_callback_;
   SelectorCallback error_callback_;
   SelectorCallback write_callback_;
+  CompletionCallback completion_callback_;
 
   Selector* selector_{};
 
+  [[nodiscard]] SelectEvents internalInterest(SelectEvents events) const;
+  void internalUpdate(SelectEvents events);
+
  public:
   using Ptr = std::shared_ptr<SocketChannel>;
 
@@ -32,6 +37,12 @@ class SocketChannel final : public Socket, public Channel {
 
   void SetSelector(Selector* selector) { selector_ = selector; }
 
+  // Must be set before the channel becomes readable or writable, falls back
+  // to kLevel if the selector does not support the trigger.
+  void SetTrigger(SelectTrigger trigger);
+
+  [[nodiscard]] SelectTrigger GetTrigger() const noexcept { return trigger_; }
+
   void OnRead(SelectorCallback read_callback) {
     read_callback_ = std::move(read_callback);
   }
@@ -48,8 +59,21 @@ class SocketChannel final : public Socket, public Channel {
     error_callback_ = std::move(error_callback);
   }
 
+  void OnComplete(CompletionCallback completion_callback) {
+    completion_callback_ = std::move(completion_callback);
+  }
+
   void HandleEvents(ReceiveEvents events, Timestamp now) final;
 
+  void HandleCompletion(const SelectCompletion& completion,
+                        Timestamp now) final;
+
+  // Keep a multishot accept or receive armed in the selector instead of
+  // waiting for the readiness, returns false if the selector does not support
+  // it.
+  bool SubmitAccept();
+  bool SubmitReceive();
+
   void SetReadable(bool on);
 
   [[nodiscard]] bool Readable() const noexcept {
@@ -62,6 +86,9 @@ class SocketChannel final : public Socket, public Channel {
 
   void SetWritable(bool on);
 
+  // Registers the current interest with a new selector, see SetSelector().
+  void Rearm();
+
   Socket& GetFile() noexcept final { return *this; }
 
   [[nodiscard]] const Socket& GetFile() const noexcept final { return *this; }
@@ -24,9 +24,18 @@ class TimerChannel final : public Channel {
 
   [[nodiscard]] std::string String() const override;
 
-  void WakeUpAt(Timestamp timestamp) {
-    WakeUpAfter(timestamp - Timestamp::Now());
-  }
+  // Leaves the deadline to the event loop instead of arming the timerfd, see
+  // EventLoopOptions::select_timer. The callback is run whenever the deadline
+  // moves earlier.
+  void SetDeadlineCallback(Callback cb) { deadline_callback_ = std::move(cb); }
+
+  // The earliest deadline since the last Expire(), in microseconds.
+  [[nodiscard]] int64_t GetDeadline() const noexcept { return deadline_us_; }
+
+  // Clears the deadline and returns true if it has been reached.
+  bool Expire(Timestamp now);
+
+  void WakeUpAt(Timestamp timestamp);
 
   void WakeUpAfter(Duration duration);
 
@@ -34,6 +43,8 @@ class TimerChannel final : public Channel {
   inline static const Duration kMinWakeUpDuration = Duration::Microseconds(100);
 
   Callback event_callback_;
+  Callback deadline_callback_;
+  std::atomic_int64_t deadline_us_{std::numeric_limits<int64_t>::max()};
   std::atomic_int64_t last_wakeup_us_{std::numeric_limits<int64_t>::max()};
   File file_;
 };
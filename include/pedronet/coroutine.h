@@ -0,0 +1,442 @@
+#ifndef PEDRONET_COROUTINE_H
+#define PEDRONET_COROUTINE_H
+
+#if !defined(__cpp_impl_coroutine)
+#error "pedronet/coroutine.h requires C++20 coroutines"
+#endif
+
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "pedronet/eventloop.h"
+#include "pedronet/logger/logger.h"
+#include "pedronet/tcp_connection.h"
+
+namespace pedronet {
+
+// Recycles coroutine frames by size class. Every loop runs on a thread of its
+// own, so the thread local pool is the pool of that loop. A frame freed on
+// another loop after a hop is recycled by that loop.
+class FramePool {
+  static constexpr size_t kGranularity = 64;
+  static constexpr size_t kClasses = 32;
+  static constexpr size_t kMaxCached = 1024;
+
+  struct Block {
+    Block* next;
+  };
+
+  struct FreeList {
+    Block* head{};
+    size_t size{};
+  };
+
+  std::array<FreeList, kClasses> lists_{};
+
+  static size_t internalClass(size_t n) noexcept {
+    return (n + kGranularity - 1) / kGranularity - 1;
+  }
+
+ public:
+  ~FramePool() {
+    for (auto& list : lists_) {
+      while (list.head != nullptr) {
+        ::operator delete(std::exchange(list.head, list.head->next));
+      }
+    }
+  }
+
+  static FramePool& Current() noexcept {
+    thread_local FramePool pool;
+    return pool;
+  }
+
+  void* Allocate(size_t n) {
+    size_t c = internalClass(n);
+    if (c >= kClasses) {
+      return ::operator new(n);
+    }
+    FreeList& list = lists_[c];
+    if (list.head == nullptr) {
+      return ::operator new((c + 1) * kGranularity);
+    }
+    --list.size;
+    return std::exchange(list.head, list.head->next);
+  }
+
+  void Deallocate(void* p, size_t n) noexcept {
+    size_t c = internalClass(n);
+    if (c >= kClasses || lists_[c].size == kMaxCached) {
+      ::operator delete(p);
+      return;
+    }
+    FreeList& list = lists_[c];
+    list.head = ::new (p) Block{list.head};
+    ++list.size;
+  }
+};
+
+namespace detail {
+
+struct FrameAllocated {
+  static void* operator new(size_t n) {
+    return FramePool::Current().Allocate(n);
+  }
+
+  static void operator delete(void* p, size_t n) noexcept {
+    FramePool::Current().Deallocate(p, n);
+  }
+};
+
+struct PromiseBase : FrameAllocated {
+  // Resumed by symmetric transfer once the coroutine finishes.
+  std::coroutine_handle<> continuation{std::noop_coroutine()};
+
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<Promise> h) noexcept {
+      return h.promise().continuation;
+    }
+
+    void await_resume() noexcept {}
+  };
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  FinalAwaiter final_suspend() noexcept { return {}; }
+  void unhandled_exception() noexcept { std::terminate(); }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+  std::optional<T> value;
+
+  template <typename U>
+  void return_value(U&& v) {
+    value.emplace(std::forward<U>(v));
+  }
+
+  T result() { return std::move(*value); }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+  void return_void() noexcept {}
+  void result() noexcept {}
+};
+
+}  // namespace detail
+
+// A lazily started coroutine returning T. It starts when awaited and resumes
+// the awaiting coroutine inline when it finishes.
+template <typename T = void>
+class [[nodiscard]] Async {
+ public:
+  struct promise_type : detail::Promise<T> {
+    Async get_return_object() noexcept {
+      return Async{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+  };
+
+  Async(Async&& other) noexcept : h_(std::exchange(other.h_, nullptr)) {}
+
+  Async& operator=(Async&& other) noexcept {
+    if (this != &other) {
+      internalDestroy();
+      h_ = std::exchange(other.h_, nullptr);
+    }
+    return *this;
+  }
+
+  ~Async() { internalDestroy(); }
+
+  auto operator co_await() && noexcept {
+    struct Awaiter {
+      std::coroutine_handle<promise_type> h;
+
+      bool await_ready() noexcept { return h.done(); }
+
+      std::coroutine_handle<> await_suspend(
+          std::coroutine_handle<> continuation) noexcept {
+        h.promise().continuation = continuation;
+        return h;
+      }
+
+      T await_resume() { return h.promise().result(); }
+    };
+    return Awaiter{h_};
+  }
+
+ private:
+  explicit Async(std::coroutine_handle<promise_type> h) noexcept : h_(h) {}
+
+  void internalDestroy() noexcept {
+    if (h_) {
+      h_.destroy();
+    }
+  }
+
+  std::coroutine_handle<promise_type> h_;
+};
+
+namespace detail {
+
+// Runs eagerly and frees its own frame when it finishes.
+struct Detached {
+  struct promise_type : FrameAllocated {
+    Detached get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+}  // namespace detail
+
+// Starts the coroutine on the calling thread, it runs until its first
+// suspension before Spawn() returns.
+inline detail::Detached Spawn(Async<> task) { co_await std::move(task); }
+
+// Suspends for the delay, the coroutine is resumed by the timer of the loop.
+inline auto Sleep(EventLoop& loop, Duration delay) noexcept {
+  struct Awaiter {
+    EventLoop& loop;
+    Duration delay;
+
+    bool await_ready() noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> h) {
+      loop.ScheduleAfter(delay, [h] { h.resume(); });
+    }
+
+    void await_resume() noexcept {}
+  };
+  return Awaiter{loop, delay};
+}
+
+// Sleeps on the loop running the coroutine, which must run on an EventLoop.
+inline auto Sleep(Duration delay) {
+  EventLoop* loop = EventLoop::GetEventLoop();
+  if (loop == nullptr) {
+    PEDRONET_FATAL("Sleep() is not awaited on an EventLoop");
+  }
+  return Sleep(*loop, delay);
+}
+
+// Continues the coroutine on the target loop, as an urgent task unless it
+// already runs there.
+inline auto SwitchTo(EventLoop& target) noexcept {
+  struct Awaiter {
+    EventLoop& target;
+
+    bool await_ready() noexcept {
+      return EventLoop::GetEventLoop() == &target;
+    }
+
+    void await_suspend(std::coroutine_handle<> h) {
+      target.Schedule(TaskPriority::kUrgent, [h] { h.resume(); });
+    }
+
+    void await_resume() noexcept {}
+  };
+  return Awaiter{target};
+}
+
+// A handler driven by a coroutine instead of callbacks. Serve() starts when
+// the connection is established, and reads and writes of the connection are
+// awaited from it. The coroutine is resumed inline by the I/O callbacks of
+// the loop owning the connection, and awaiting I/O from another loop hops
+// back onto that loop. Subclasses overriding the callbacks must call the
+// ones of CoroutineHandler.
+class CoroutineHandler
+    : public ChannelHandlerAdaptor,
+      public std::enable_shared_from_this<CoroutineHandler> {
+  struct ReadAwaiter {
+    CoroutineHandler& self;
+    size_t n;
+
+    bool await_ready() noexcept {
+      return self.internalOwned() && self.internalReadable(n);
+    }
+
+    bool await_suspend(std::coroutine_handle<> h) {
+      return self.internalWait(
+          h, [this] { return self.internalReadable(n); },
+          [this, h] {
+            self.reader_ = h;
+            self.want_ = n;
+          });
+    }
+
+    ArrayBuffer* await_resume() noexcept {
+      ArrayBuffer* input = self.internalInput();
+      if (input == nullptr || input->ReadableBytes() < n) {
+        return nullptr;
+      }
+      return input;
+    }
+  };
+
+  struct FlushAwaiter {
+    CoroutineHandler& self;
+    // Left by a Write() off the loop of the connection, it is sent by the
+    // same loop task that checks the flush so the check cannot run first.
+    std::string pending;
+
+    bool await_ready() noexcept {
+      return self.internalOwned() && self.internalFlushed();
+    }
+
+    bool await_suspend(std::coroutine_handle<> h) {
+      return self.internalWait(
+          h,
+          [this] {
+            self.internalSend(pending);
+            return self.internalFlushed();
+          },
+          [this, h] { self.writer_ = h; });
+    }
+
+    bool await_resume() noexcept { return !self.closed_; }
+  };
+
+ public:
+  using Ptr = std::shared_ptr<CoroutineHandler>;
+
+  using ChannelHandlerAdaptor::ChannelHandlerAdaptor;
+
+  virtual Async<> Serve() = 0;
+
+  // Resumes with the input buffer once it holds at least n bytes, or with
+  // nullptr if the connection is closed first. Consumed bytes are retrieved
+  // from the buffer, which is only valid until the next suspension.
+  ReadAwaiter Read(size_t n) noexcept { return ReadAwaiter{*this, n}; }
+
+  // Sends the buffer and resumes once the output of the connection is
+  // flushed, with false if the connection is closed first. Off the loop of
+  // the connection the bytes are only sent once the result is awaited.
+  [[nodiscard]] FlushAwaiter Write(ArrayBuffer* buffer) {
+    FlushAwaiter awaiter{*this};
+    if (internalOwned()) {
+      if (auto conn = GetConnection(); conn != nullptr) {
+        conn->Send(buffer);
+      }
+      return awaiter;
+    }
+    awaiter.pending.assign(buffer->ReadIndex(), buffer->ReadableBytes());
+    buffer->Reset();
+    return awaiter;
+  }
+
+  [[nodiscard]] FlushAwaiter Write(std::string_view buffer) {
+    FlushAwaiter awaiter{*this};
+    if (internalOwned()) {
+      if (auto conn = GetConnection(); conn != nullptr) {
+        conn->Send(buffer);
+      }
+      return awaiter;
+    }
+    awaiter.pending.assign(buffer);
+    return awaiter;
+  }
+
+  void OnConnect(Timestamp now) override {
+    Spawn(internalServe(shared_from_this()));
+  }
+
+  void OnRead(Timestamp now, ArrayBuffer& buffer) override {
+    if (reader_ && buffer.ReadableBytes() >= want_) {
+      std::exchange(reader_, nullptr).resume();
+    }
+  }
+
+  void OnWriteComplete(Timestamp now) override {
+    if (writer_) {
+      std::exchange(writer_, nullptr).resume();
+    }
+  }
+
+  void OnClose(Timestamp now) override {
+    closed_ = true;
+    if (reader_) {
+      std::exchange(reader_, nullptr).resume();
+    }
+    if (writer_) {
+      std::exchange(writer_, nullptr).resume();
+    }
+  }
+
+ private:
+  static Async<> internalServe(Ptr self) { co_await self->Serve(); }
+
+  bool internalOwned() {
+    auto conn = GetConnection();
+    return conn == nullptr ||
+           EventLoop::GetEventLoop() == &conn->GetEventLoop();
+  }
+
+  ArrayBuffer* internalInput() { return GetContext().GetInputBuffer(); }
+
+  bool internalReadable(size_t n) {
+    ArrayBuffer* input = internalInput();
+    return closed_ || input == nullptr || input->ReadableBytes() >= n;
+  }
+
+  void internalSend(std::string& pending) {
+    auto conn = GetConnection();
+    if (conn != nullptr && !pending.empty()) {
+      conn->Send(std::string_view{pending});
+    }
+    pending.clear();
+  }
+
+  bool internalFlushed() {
+    ArrayBuffer* output = GetContext().GetOutputBuffer();
+    return closed_ || output == nullptr || output->ReadableBytes() == 0;
+  }
+
+  // Returns false to resume right away if ready, otherwise parks the
+  // coroutine, on the loop of the connection if it runs elsewhere.
+  template <typename Ready, typename Park>
+  bool internalWait(std::coroutine_handle<> h, Ready ready, Park park) {
+    auto conn = GetConnection();
+    if (conn == nullptr) {
+      return false;
+    }
+    if (EventLoop::GetEventLoop() == &conn->GetEventLoop()) {
+      if (ready()) {
+        return false;
+      }
+      park();
+      return true;
+    }
+    conn->GetEventLoop().Schedule(TaskPriority::kUrgent, [=] {
+      if (ready()) {
+        h.resume();
+      } else {
+        park();
+      }
+    });
+    return true;
+  }
+
+  std::coroutine_handle<> reader_;
+  size_t want_{};
+  std::coroutine_handle<> writer_;
+  bool closed_{};
+};
+
+}  // namespace pedronet
+
+#endif  // PEDRONET_COROUTINE_H
@@ -65,6 +65,7 @@ class ReceiveEvents {
   static const ReceiveEvents kPriorReadable;
   static const ReceiveEvents kReadHangUp;
   static const ReceiveEvents kWritable;
+  static const ReceiveEvents kCompletion;
 
   ReceiveEvents() = default;
 
@@ -102,6 +103,24 @@ class ReceiveEvents {
     return *this;
   }
 };
+
+enum class SelectOperation {
+  kNone,
+  kAccept,
+  kReceive,
+};
+
+// The result of a completion-based operation, see Selector::Accept and
+// Selector::Receive.
+struct SelectCompletion {
+  SelectOperation operation{SelectOperation::kNone};
+
+  // The accepted descriptor, the received bytes or -errno.
+  int32_t result{};
+
+  // The received bytes, only valid until the next Selector::Wait.
+  const char* data{};
+};
 }  // namespace pedronet
 
 PEDROLIB_CLASS_FORMATTER(pedronet::SelectEvents);
@@ -3,20 +3,28 @@
 
 #include <concurrentqueue.h>
 #include <pedrolib/concurrent/latch.h>
+#include <array>
 #include <atomic>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include "pedrolib/executor/executor.h"
 #include "pedronet/callbacks.h"
 #include "pedronet/channel/channel.h"
 #include "pedronet/channel/event_channel.h"
 #include "pedronet/channel/timer_channel.h"
 #include "pedronet/event.h"
+#include "pedronet/metrics.h"
 #include "pedronet/queue/event_queue_factory.h"
 #include "pedronet/queue/timer_queue_factory.h"
 #include "pedronet/selector/selector_factory.h"
+#include "pedronet/watchdog.h"
 
 namespace pedronet {
 
-class EventLoop : public Executor {
+// Cache line aligned, so the atomics of adjacent loops never share a line.
+class alignas(64) EventLoop : public Executor {
   enum State {
     kLooping = 1 << 0,
     kJoinable = 1 << 1,
@@ -26,9 +34,84 @@ class EventLoop : public Executor {
 
   void join();
 
+  [[nodiscard]] Duration internalTimeout() const;
+  void internalBusyPoll(size_t events, Timestamp now);
+
+  EventQueue* internalQueue(TaskPriority priority) const noexcept {
+    return event_queues_[static_cast<size_t>(priority)].get();
+  }
+
+  uint64_t internalAddTimer(Duration delay, Duration interval, Duration slack,
+                            Task task) {
+    if (current() == this) {
+      return timer_queue_->Add(delay, interval, slack, std::move(task));
+    }
+    return timer_queue_->Stage(delay, interval, slack, std::move(task));
+  }
+
+  [[nodiscard]] bool internalPending() const;
+  void internalDrain(bool urgent_only);
+  size_t internalDrain(TaskPriority priority, const TaskBudget& budget);
+  size_t internalDrainUrgent();
+
+  // Publishes what the loop is doing for the watchdog, a no-op unless the
+  // library is built with PEDRONET_WATCHDOG.
+  void internalActivity(LoopActivity::Stage stage,
+                        Channel* channel = nullptr) noexcept {
+#ifdef PEDRONET_WATCHDOG
+    activity_.stage.store(stage, std::memory_order_relaxed);
+    if (channel != nullptr) {
+      activity_.channel.store(&typeid(*channel), std::memory_order_relaxed);
+      activity_.fd.store(channel->GetFile().Descriptor(),
+                         std::memory_order_relaxed);
+    } else {
+      activity_.channel.store(nullptr, std::memory_order_relaxed);
+    }
+#endif
+  }
+
  public:
+  // Shared with the threads which schedule on a loop they do not own and may
+  // outlive it. Schedule() refuses once Close() is called, instead of
+  // queueing tasks the loop never runs or touching a destroyed loop.
+  class Handle {
+   public:
+    explicit Handle(EventLoop* loop) : loop_(loop) {}
+
+    template <typename Runnable>
+    bool Schedule(Runnable&& runnable) {
+      std::unique_lock lock(mu_);
+      if (loop_ == nullptr) {
+        return false;
+      }
+      loop_->Schedule(std::forward<Runnable>(runnable));
+      return true;
+    }
+
+    [[nodiscard]] bool Closed() const noexcept {
+      return closed_.load(std::memory_order_acquire);
+    }
+
+   private:
+    friend class EventLoop;
+
+    void Close() {
+      std::unique_lock lock(mu_);
+      loop_ = nullptr;
+      closed_.store(true, std::memory_order_release);
+    }
+
+    SpinLock mu_;
+    EventLoop* loop_;
+    std::atomic_bool closed_{};
+  };
+
   static EventLoop* GetEventLoop() noexcept { return current(); }
 
+  [[nodiscard]] const std::shared_ptr<Handle>& GetHandle() const noexcept {
+    return handle_;
+  }
+
   explicit EventLoop(const EventLoopOptions& options);
 
   Selector* GetSelector() noexcept { return selector_.get(); }
@@ -41,16 +124,88 @@ class EventLoop : public Executor {
 
   void Schedule(Callback cb) override;
 
+  // Overloads taking any callable, it goes into the queues as a Task without
+  // being wrapped into a std::function first.
+  template <typename Runnable>
+  void Schedule(Runnable&& runnable) {
+    Schedule(TaskPriority::kNormal, std::forward<Runnable>(runnable));
+  }
+
+  // Urgent tasks run as soon as the loop wakes up, normal and background
+  // ones after the I/O of an iteration within their budgets, see
+  // EventLoopOptions::normal_budget.
+  template <typename Runnable>
+  void Schedule(TaskPriority priority, Runnable&& runnable) {
+    internalQueue(priority)->Add(Task{std::forward<Runnable>(runnable)});
+  }
+
+  // Enqueues the callables of [first, last) as one batch, with at most one
+  // wakeup of the loop. Pass move iterators to move them into the queue.
+  template <typename Iterator>
+  void ScheduleBatch(Iterator first, Iterator last,
+                     TaskPriority priority = TaskPriority::kNormal) {
+    thread_local std::vector<Task> batch;
+    for (; first != last; ++first) {
+      batch.emplace_back(*first);
+    }
+    internalQueue(priority)->AddBatch(batch.data(), batch.size());
+    batch.clear();
+  }
+
+  template <typename Range>
+  void ScheduleBatch(Range&& range,
+                     TaskPriority priority = TaskPriority::kNormal) {
+    ScheduleBatch(std::begin(range), std::end(range), priority);
+  }
+
+  // Timers of the loop thread go into the timer queue directly, the other
+  // threads stage them, see TimerQueue.
   uint64_t ScheduleAfter(Duration delay, Callback cb) override {
-    return timer_queue_->Add(delay, Duration::Zero(), std::move(cb));
+    return ScheduleAfter(delay, Duration::Zero(), std::move(cb));
+  }
+
+  template <typename Runnable>
+  uint64_t ScheduleAfter(Duration delay, Runnable&& runnable) {
+    return ScheduleAfter(delay, Duration::Zero(),
+                         std::forward<Runnable>(runnable));
+  }
+
+  // A timer with a slack may fire up to slack late, the loop then wakes up
+  // once for all the timers whose windows overlap. Fits keepalives, idle
+  // checks and the like.
+  template <typename Runnable>
+  uint64_t ScheduleAfter(Duration delay, Duration slack,
+                         Runnable&& runnable) {
+    return internalAddTimer(delay, Duration::Zero(), slack,
+                            Task{std::forward<Runnable>(runnable)});
   }
 
   uint64_t ScheduleEvery(Duration delay, Duration interval,
                          Callback cb) override {
-    return timer_queue_->Add(delay, interval, std::move(cb));
+    return ScheduleEvery(delay, interval, Duration::Zero(), std::move(cb));
   }
 
-  void ScheduleCancel(uint64_t id) override { timer_queue_->Cancel(id); }
+  template <typename Runnable>
+  uint64_t ScheduleEvery(Duration delay, Duration interval,
+                         Runnable&& runnable) {
+    return ScheduleEvery(delay, interval, Duration::Zero(),
+                         std::forward<Runnable>(runnable));
+  }
+
+  template <typename Runnable>
+  uint64_t ScheduleEvery(Duration delay, Duration interval, Duration slack,
+                         Runnable&& runnable) {
+    return internalAddTimer(delay, interval, slack,
+                            Task{std::forward<Runnable>(runnable)});
+  }
+
+  void ScheduleCancel(uint64_t id) override {
+    if (current() == this) {
+      timer_queue_->Cancel(id);
+      return;
+    }
+    timer_queue_->StageCancel(id);
+  }
 
   template <typename Runnable>
   void Run(Runnable&& runnable) {
@@ -65,20 +220,66 @@ class EventLoop : public Executor {
 
   void Loop();
 
-  ~EventLoop() override { join(); }
+  ~EventLoop() override {
+    handle_->Close();
+    join();
+  }
 
   void Join() override;
 
+  // Safe to call from any thread, all the histograms are empty unless the
+  // library is built with PEDRONET_METRICS.
+  [[nodiscard]] LoopMetrics::Snapshot GetMetrics() const noexcept;
+
+  // Load counters for the placement policies of EventLoopGroup, both may be
+  // read from any thread.
+  void AttachConnection() noexcept {
+    connections_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void DetachConnection() noexcept {
+    connections_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] size_t GetConnections() const noexcept {
+    return connections_.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] size_t GetQueueDepth() const;
+
+  // Stays idle unless the library is built with PEDRONET_WATCHDOG.
+  [[nodiscard]] const LoopActivity& GetActivity() const noexcept {
+    return activity_;
+  }
+
  private:
   EventLoopOptions options_;
   EventChannel::Ptr event_channel_;
   TimerChannel::Ptr timer_channel_;
   std::unique_ptr<Selector> selector_;
-  std::unique_ptr<EventQueue> event_queue_;
+  // Indexed by TaskPriority.
+  std::array<std::unique_ptr<EventQueue>, 3> event_queues_;
   std::unique_ptr<TimerQueue> timer_queue_;
+  std::shared_ptr<Handle> handle_{std::make_shared<Handle>(this)};
 
   std::atomic_int32_t state_{};
   Latch close_latch_{1};
+
+  std::atomic_size_t connections_{};
+
+  LoopActivity activity_;
+
+  // See EventLoopOptions::busy_poll.
+  bool spinning_{};
+  Duration spin_budget_;
+  Timestamp spin_deadline_;
+
+#ifdef PEDRONET_METRICS
+  LoopMetrics metrics_;
+  // Tasks drained in the current iteration and the time it took.
+  uint64_t drain_ns_{};
+  uint64_t drained_{};
+#endif
 };
 
 }  // namespace pedronet
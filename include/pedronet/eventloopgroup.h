@@ -3,10 +3,14 @@
 
 #include "pedronet/eventloop.h"
 #include "pedronet/selector/epoller.h"
+#include "pedronet/watchdog.h"
 
 #include <pedrolib/collection/static_vector.h>
 #include <atomic>
+#include <iterator>
+#include <memory>
 #include <thread>
+#include <vector>
 
 namespace pedronet {
 
@@ -38,44 +42,83 @@ class EventLoopGroup : public Executor {
   }
 
   static EventLoopGroup::Ptr Create(size_t threads,
-                                    const EventLoopOptions& options) {
-    auto group = std::make_shared<EventLoopGroup>(threads);
-
-    for (size_t i = 0; i < threads; ++i) {
-      group->loops_.emplace_back(options);
-    }
-    for (size_t i = 0; i < threads; ++i) {
-      auto& loop = group->loops_[i];
-      group->threads_.emplace_back([&loop] { loop.Loop(); });
-    }
-    return group;
-  }
+                                    const EventLoopOptions& options);
 
   ~EventLoopGroup() override {
     Close();
     HandleJoin();
   }
 
-  EventLoop& Next() { return loops_[next()]; }
+  EventLoop& Next() { return *loops_[next()]; }
+
+  EventLoop& Next(PlacementPolicy policy);
+
+  EventLoop& GetLoop(size_t index) { return *loops_[index]; }
 
   void Join() override;
 
   void Schedule(Callback cb) override { Next().Schedule(std::move(cb)); }
 
+  template <typename Runnable>
+  void Schedule(Runnable&& runnable) {
+    Next().Schedule(std::forward<Runnable>(runnable));
+  }
+
+  template <typename Runnable>
+  void Schedule(TaskPriority priority, Runnable&& runnable) {
+    Next().Schedule(priority, std::forward<Runnable>(runnable));
+  }
+
+  // Fans [first, last) out over all the loops, every loop gets a contiguous
+  // share of the callables as a single batch.
+  template <typename Iterator>
+  void ScheduleBatch(Iterator first, Iterator last) {
+    size_t n = std::distance(first, last);
+    size_t loop_id = next();
+    for (size_t i = 0; i < size_ && n != 0; ++i) {
+      size_t share = (n + size_ - i - 1) / (size_ - i);
+      Iterator end = std::next(first, share);
+      loops_[(loop_id + i) % size_]->ScheduleBatch(first, end);
+      first = end;
+      n -= share;
+    }
+  }
+
+  template <typename Range>
+  void ScheduleBatch(Range&& range) {
+    ScheduleBatch(std::begin(range), std::end(range));
+  }
+
   uint64_t ScheduleAfter(Duration delay, Callback cb) override;
 
+  // See EventLoop::ScheduleAfter() for the slack.
+  uint64_t ScheduleAfter(Duration delay, Duration slack, Callback cb);
+
   uint64_t ScheduleEvery(Duration delay, Duration interval,
                          Callback cb) override;
 
+  uint64_t ScheduleEvery(Duration delay, Duration interval, Duration slack,
+                         Callback cb);
+
   void ScheduleCancel(uint64_t id) override;
 
   void Close() override;
 
+  // Metrics of the index-th loop, and of all the loops merged.
+  LoopMetrics::Snapshot GetMetrics(size_t index) {
+    return loops_[index]->GetMetrics();
+  }
+
+  LoopMetrics::Snapshot GetMetrics();
+
  private:
-  pedrolib::StaticVector<EventLoop> loops_;
+  // Every loop is a separate allocation made by its own thread.
+  std::vector<std::unique_ptr<EventLoop>> loops_;
   pedrolib::StaticVector<std::thread> threads_;
   std::atomic_size_t next_;
   const size_t size_;
+  // See EventLoopOptions::stall_threshold.
+  std::unique_ptr<Watchdog> watchdog_;
 };
 
 }  // namespace pedronet
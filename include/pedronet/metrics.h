@@ -0,0 +1,91 @@
+#ifndef PEDRONET_METRICS_H
+#define PEDRONET_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace pedronet {
+
+// Log2 histogram, bucket 0 counts zeros and bucket i counts the values in
+// [2^(i-1), 2^i). Written by one thread, readable from any thread.
+class Histogram {
+ public:
+  static constexpr size_t kBuckets = 65;
+
+  struct Snapshot {
+    std::array<uint64_t, kBuckets> buckets{};
+    uint64_t count{};
+    uint64_t sum{};
+    uint64_t max{};
+
+    void Merge(const Snapshot& other) noexcept;
+
+    [[nodiscard]] double Mean() const noexcept;
+
+    // Upper bound of the bucket holding the p-quantile, p in [0, 1].
+    [[nodiscard]] uint64_t Percentile(double p) const noexcept;
+  };
+
+  void Record(uint64_t value) noexcept {
+    size_t bucket = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    internalAdd(buckets_[bucket], 1);
+    internalAdd(count_, 1);
+    internalAdd(sum_, value);
+    if (value > max_.load(std::memory_order_relaxed)) {
+      max_.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  [[nodiscard]] Snapshot Get() const noexcept;
+
+ private:
+  // There is a single writer, so no read-modify-write is needed.
+  static void internalAdd(std::atomic_uint64_t& v, uint64_t n) noexcept {
+    v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  std::array<std::atomic_uint64_t, kBuckets> buckets_{};
+  std::atomic_uint64_t count_{};
+  std::atomic_uint64_t sum_{};
+  std::atomic_uint64_t max_{};
+};
+
+// Recorded by EventLoop::Loop() once per iteration when the library is built
+// with PEDRONET_METRICS, see EventLoop::GetMetrics().
+struct LoopMetrics {
+  struct Snapshot {
+    Histogram::Snapshot wait_ns;
+    Histogram::Snapshot ready;
+    Histogram::Snapshot dispatch_ns;
+    Histogram::Snapshot drain_ns;
+    Histogram::Snapshot tasks;
+    Histogram::Snapshot timer_lag_us;
+
+    void Merge(const Snapshot& other) noexcept;
+  };
+
+  // Time blocked in Selector::Wait().
+  Histogram wait_ns;
+  // Number of ready channels returned by Selector::Wait().
+  Histogram ready;
+  // Time spent in the channel handlers, excluding the event queue.
+  Histogram dispatch_ns;
+  // Time spent running tasks from the event queue, and their number.
+  Histogram drain_ns;
+  Histogram tasks;
+  // Fire time minus deadline of every timer.
+  Histogram timer_lag_us;
+
+  [[nodiscard]] Snapshot Get() const noexcept;
+
+  static uint64_t Now() noexcept {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+  }
+};
+
+}  // namespace pedronet
+
+#endif  // PEDRONET_METRICS_H
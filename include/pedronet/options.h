@@ -1,7 +1,11 @@
 #ifndef PEDRONET_OPTIONS_H
 #define PEDRONET_OPTIONS_H
 
+#include <functional>
+#include <string>
+#include <vector>
 #include "pedronet/defines.h"
+#include "pedronet/event.h"
 
 namespace pedronet {
 
@@ -9,17 +13,56 @@ enum class EventQueueType {
   kBlockingQueue,
   kDoubleBufferQueue,
   kLockFreeQueue,
+  kSpscMesh,
 };
 
-enum class TimerQueueType { kHashWheel, kHeap };
+enum class TimerQueueType { kHashWheel, kHeap, kHierarchicalWheel };
 
-enum class SelectorType { kEpoll, kPoll };
+enum class SelectorType { kEpoll, kPoll, kIoUring };
+
+enum class TaskPriority { kUrgent, kNormal, kBackground };
+
+// How EventLoopGroup::Next() picks the loop of a new connection.
+enum class PlacementPolicy {
+  kRoundRobin,
+  // The loop with the fewest live connections.
+  kLeastConnections,
+  // The loop with the fewest queued tasks.
+  kLeastQueueDepth,
+  // The one with fewer connections out of two random loops.
+  kPowerOfTwoChoices,
+};
+
+// A loop busy in a single iteration for longer than the threshold of the
+// watchdog, see EventLoopOptions::stall_threshold.
+struct StallReport {
+  size_t loop{};
+  Duration stalled;
+  // What the loop was running, e.g. the channel it dispatched to or the type
+  // of the task it ran.
+  std::string culprit;
+};
+
+// Zero means no limit.
+struct TaskBudget {
+  size_t tasks{};
+  Duration time{Duration::Zero()};
+};
 
 struct SocketOptions {
   bool reuse_addr{true};
   bool reuse_port{false};
   bool keep_alive{true};
   bool tcp_no_delay{true};
+
+  // Connections registered as edge-triggered drain their reads and writes
+  // until EAGAIN and keep the write interest armed, so they don't touch the
+  // selector on partial writes. Only effective if the selector supports it.
+  SelectTrigger trigger{SelectTrigger::kLevel};
+
+  // SO_BUSY_POLL, lets blocking reads poll the device queue for up to this
+  // long. Zero leaves the system default, raising it needs CAP_NET_ADMIN.
+  Duration busy_poll{Duration::Zero()};
 };
 
 struct EventLoopOptions {
@@ -27,11 +70,44 @@ struct EventLoopOptions {
   TimerQueueType timer_queue_type{TimerQueueType::kHeap};
   SelectorType selector_type{SelectorType::kEpoll};
   Duration select_timeout{Duration::Seconds(10)};
+
+  // Spin on a zero-timeout Wait() for up to this long after the last event
+  // before blocking in the selector. The budget halves every time it runs out
+  // idle and doubles back when events show up while spinning. Zero disables
+  // busy polling.
+  Duration busy_poll{Duration::Zero()};
+
+  // Timers are driven by the timeout of Wait() instead of a timerfd, which
+  // saves arming and reading the timerfd for every expiry.
+  bool select_timer{false};
+
+  // Limits on the normal and background tasks run per loop iteration, what
+  // is left over waits for the next iteration. Urgent tasks always run.
+  TaskBudget normal_budget{};
+  TaskBudget background_budget{};
+
+  // CPUs the loops of an EventLoopGroup are pinned to, the i-th loop runs on
+  // cpus[i % cpus.size()]. Empty leaves the threads unpinned.
+  std::vector<int> cpus;
+
+  // A thread of the EventLoopGroup reports every loop stuck in one iteration
+  // for longer than this, once per stall, to stall_callback or else as a
+  // warning. Needs the library built with PEDRONET_WATCHDOG, zero disables.
+  Duration stall_threshold{Duration::Zero()};
+  std::function<void(const StallReport&)> stall_callback;
 };
 
 struct TcpServerOptions {
   SocketOptions boss_options{};
   SocketOptions child_options{};
+  PlacementPolicy placement{PlacementPolicy::kRoundRobin};
+
+  // Every interval, connections are migrated from the worker loop with the
+  // most traffic to the one with the least, as long as the busiest carries
+  // more than rebalance_ratio times the traffic of the idlest. Zero disables
+  // rebalancing.
+  Duration rebalance_interval{Duration::Zero()};
+  double rebalance_ratio{1.5};
 };
 
 struct TcpClientOptions {
@@ -11,15 +11,15 @@ class EventBlockingQueue final : public EventQueue {
   EventChannel* channel_{};
 
   std::mutex mu_;
-  std::deque<Callback> queue_;
+  std::deque<Task> queue_;
 
-  bool Pop(Callback& callback) {
+  bool Pop(Task& task) {
     std::unique_lock lock{mu_};
     if (queue_.empty()) {
       return false;
     }
 
-    callback = std::move(queue_.front());
+    task = std::move(queue_.front());
     queue_.pop_front();
     return true;
   }
@@ -27,9 +27,9 @@ class EventBlockingQueue final : public EventQueue {
  public:
   explicit EventBlockingQueue(EventChannel* channel) : channel_(channel) {}
 
-  void Add(Callback callback) override {
+  void Add(Task task) override {
     std::unique_lock lock{mu_};
-    queue_.emplace_back(std::move(callback));
+    queue_.emplace_back(std::move(task));
 
     // the previous deque is empty.
     if (queue_.size() == 1) {
@@ -37,11 +37,27 @@ class EventBlockingQueue final : public EventQueue {
     }
   }
 
-  void Process() override {
-    Callback callback;
-    while (Pop(callback)) {
-      callback();
+  void AddBatch(Task* tasks, size_t n) override {
+    std::unique_lock lock{mu_};
+    bool empty = queue_.empty();
+    for (size_t i = 0; i < n; ++i) {
+      queue_.emplace_back(std::move(tasks[i]));
+    }
+
+    if (empty && n != 0) {
+      channel_->WakeUp();
+    }
+  }
+
+  using EventQueue::Process;
+
+  size_t Process(size_t max) override {
+    size_t n = 0;
+    Task task;
+    for (; n < max && Pop(task); ++n) {
+      task();
     }
+    return n;
   }
 
   size_t Size() override { 
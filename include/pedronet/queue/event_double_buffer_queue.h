@@ -1,5 +1,6 @@
 #ifndef PEDRONET_EVENT_DOUBLE_BUFFER_QUEUE_H
 #define PEDRONET_EVENT_DOUBLE_BUFFER_QUEUE_H
+#include <algorithm>
 #include "pedronet/channel/event_channel.h"
 #include "pedronet/queue/event_queue.h"
 namespace pedronet {
@@ -8,14 +9,17 @@ class EventDoubleBufferQueue final : public EventQueue {
   EventChannel* channel_;
 
   std::mutex mu_;
-  std::vector<Callback> pending_;
-  std::vector<Callback> running_;
+  std::vector<Task> pending_;
+  std::vector<Task> running_;
+  // The tasks of running_ before it have been run.
+  size_t next_{};
+  std::atomic_size_t left_{};
 
  public:
-  void Add(Callback callback) override {
+  void Add(Task task) override {
     std::unique_lock lock{mu_};
 
-    pending_.emplace_back(std::move(callback));
+    pending_.emplace_back(std::move(task));
 
     // the pending buffer size is empty before insertion.
     if (pending_.size() == 1) {
@@ -23,21 +27,42 @@ class EventDoubleBufferQueue final : public EventQueue {
     }
   }
 
-  void Process() override {
+  void AddBatch(Task* tasks, size_t n) override {
     std::unique_lock lock{mu_};
-    running_.swap(pending_);
-    lock.unlock();
+    bool empty = pending_.empty();
+    for (size_t i = 0; i < n; ++i) {
+      pending_.emplace_back(std::move(tasks[i]));
+    }
 
-    for (Callback& callback : running_) {
-      callback();
+    if (empty && n != 0) {
+      channel_->WakeUp();
     }
+  }
 
-    running_.clear();
+  using EventQueue::Process;
+
+  size_t Process(size_t max) override {
+    if (running_.empty()) {
+      std::unique_lock lock{mu_};
+      running_.swap(pending_);
+    }
+
+    size_t n = std::min(max, running_.size() - next_);
+    for (size_t i = 0; i < n; ++i) {
+      running_[next_++]();
+    }
+
+    if (next_ == running_.size()) {
+      running_.clear();
+      next_ = 0;
+    }
+    left_.store(running_.size() - next_, std::memory_order_relaxed);
+    return n;
   }
 
   size_t Size() override {
     std::unique_lock lock{mu_};
-    return pending_.size();
+    return pending_.size() + left_.load(std::memory_order_relaxed);
   }
 
   explicit EventDoubleBufferQueue(EventChannel* channel) : channel_(channel) {}
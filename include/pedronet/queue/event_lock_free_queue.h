@@ -5,20 +5,21 @@
 #include "pedronet/queue/event_queue.h"
 
 #include <concurrentqueue.h>
+#include <algorithm>
+#include <iterator>
 
 namespace pedronet {
 class EventLockFreeQueue final : public EventQueue {
   EventChannel* channel_;
 
   std::atomic_size_t size_{};
-  moodycamel::ConcurrentQueue<Callback> queue_;
+  moodycamel::ConcurrentQueue<Task> queue_;
 
  public:
   explicit EventLockFreeQueue(EventChannel* channel) : channel_(channel) {}
 
-  void Add(Callback callback) override {
-    while (
-        !queue_.enqueue(std::move(callback))) {  // NOLINT: no move if failed.
+  void Add(Task task) override {
+    while (!queue_.enqueue(std::move(task))) {  // NOLINT: no move if failed.
       std::this_thread::yield();
     }
 
@@ -27,10 +28,29 @@ class EventLockFreeQueue final : public EventQueue {
     }
   }
 
-  void Process() override {
-    std::array<Callback, 32> buf;
-    while (true) {
-      size_t n = queue_.try_dequeue_bulk(buf.begin(), buf.size());
+  void AddBatch(Task* tasks, size_t n) override {
+    if (n == 0) {
+      return;
+    }
+
+    auto it = std::make_move_iterator(tasks);
+    while (!queue_.enqueue_bulk(it, n)) {
+      std::this_thread::yield();
+    }
+
+    if (size_.fetch_add(n) == 0) {
+      channel_->WakeUp();
+    }
+  }
+
+  using EventQueue::Process;
+
+  size_t Process(size_t max) override {
+    size_t total = 0;
+    std::array<Task, 32> buf;
+    while (total < max) {
+      size_t n = std::min(buf.size(), max - total);
+      n = queue_.try_dequeue_bulk(buf.begin(), n);
       if (n == 0) {
         break;
       }
@@ -38,7 +58,9 @@ class EventLockFreeQueue final : public EventQueue {
       for (int i = 0; i < n; ++i) {
         buf[i]();
       }
+      total += n;
     }
+    return total;
   }
 
   size_t Size() override { return size_; }
@@ -1,15 +1,35 @@
 #ifndef PEDRONET_QUEUE_EVENT_QUEUE_H
 #define PEDRONET_QUEUE_EVENT_QUEUE_H
 
+#include <limits>
 #include "pedronet/defines.h"
+#include "pedronet/task.h"
 
 namespace pedronet {
 
 struct EventQueue {
   virtual ~EventQueue() = default;
-  virtual void Add(Callback callback) = 0;
-  virtual void Process() = 0;
+  virtual void Add(Task task) = 0;
+
+  // Moves n tasks into the queue at once, waking the loop up at most once.
+  virtual void AddBatch(Task* tasks, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      Add(std::move(tasks[i]));
+    }
+  }
+
+  // Runs the queued tasks and returns their number.
+  size_t Process() { return Process(std::numeric_limits<size_t>::max()); }
+
+  // Runs at most max tasks, the rest are left queued for the next call.
+  virtual size_t Process(size_t max) = 0;
+
+  // The number of queued tasks, approximate while producers keep adding.
   virtual size_t Size() = 0;
+
+  // Checked by the loop on every iteration, so a queue whose Size() is
+  // expensive to count overrides it.
+  virtual bool Empty() { return Size() == 0; }
 };
 }  // namespace pedronet
 
@@ -4,6 +4,7 @@
 #include "pedronet/queue/event_blocking_queue.h"
 #include "pedronet/queue/event_double_buffer_queue.h"
 #include "pedronet/queue/event_lock_free_queue.h"
+#include "pedronet/queue/event_spsc_mesh_queue.h"
 #include "pedronet/options.h"
 
 namespace pedronet {
@@ -17,6 +18,8 @@ inline static std::unique_ptr<EventQueue> MakeEventQueue(EventQueueType type,
       return std::make_unique<EventDoubleBufferQueue>(channel);
     case EventQueueType::kLockFreeQueue:
       return std::make_unique<EventLockFreeQueue>(channel);
+    case EventQueueType::kSpscMesh:
+      return std::make_unique<EventSpscMeshQueue>(channel);
     default:
       return nullptr;
   }
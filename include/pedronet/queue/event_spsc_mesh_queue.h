@@ -0,0 +1,338 @@
+#ifndef PEDRONET_EVENT_SPSC_MESH_QUEUE_H
+#define PEDRONET_EVENT_SPSC_MESH_QUEUE_H
+
+#include <concurrentqueue.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pedronet/channel/event_channel.h"
+#include "pedronet/queue/event_queue.h"
+
+namespace pedronet {
+
+// Every producer thread gets its own bounded single-producer ring into the
+// loop, so producers don't share a cache line on Add(). A producer only
+// touches the shared ready mask when its ring goes from empty to non-empty,
+// and Process() only visits the rings marked in it. When a ring is full the
+// producer spills into an overflow list of that ring, and threads beyond
+// kMaxRings share one moodycamel queue.
+class EventSpscMeshQueue final : public EventQueue {
+  static constexpr size_t kCapacity = 256;
+  static constexpr size_t kMask = kCapacity - 1;
+  static constexpr size_t kMaxRings = 63;
+  static constexpr size_t kShared = kMaxRings;
+
+  struct Ring {
+    alignas(64) std::atomic_size_t head{};
+
+    alignas(64) std::atomic_size_t tail{};
+    size_t cached_head{};
+
+    // Owned by a live producer thread.
+    std::atomic_bool claimed{true};
+
+    alignas(64) std::atomic_bool overflowed{};
+    SpinLock mu;
+    std::vector<Task> overflow;
+    std::vector<Task> spare;
+    size_t next_spare{};
+    // The tasks in overflow and spare, for Size().
+    std::atomic_size_t spilled{};
+
+    std::array<Task, kCapacity> slots;
+  };
+
+  struct Mailbox {
+    uint64_t queue{};
+    size_t index{};
+    std::shared_ptr<Ring> ring;
+  };
+
+  // Releases the rings of a thread when it exits, they may be claimed by
+  // other threads afterwards.
+  struct Mailboxes {
+    std::vector<Mailbox> boxes;
+
+    ~Mailboxes() {
+      for (auto& box : boxes) {
+        if (box.ring != nullptr) {
+          box.ring->claimed.store(false, std::memory_order_release);
+        }
+      }
+    }
+  };
+
+  static Mailboxes& mailboxes() {
+    thread_local Mailboxes mailboxes;
+    return mailboxes;
+  }
+
+  // Every queue owns a slot, the index of its mailbox in every thread. The
+  // slots of destroyed queues are reused, so a thread keeps no more
+  // mailboxes than queues have been alive at a time.
+  struct Slots {
+    std::mutex mu;
+    std::vector<size_t> free;
+    size_t size{};
+  };
+
+  static Slots& slots() {
+    static Slots slots;
+    return slots;
+  }
+
+  static size_t AcquireSlot() {
+    Slots& s = slots();
+    std::unique_lock lock(s.mu);
+    if (s.free.empty()) {
+      return s.size++;
+    }
+    size_t slot = s.free.back();
+    s.free.pop_back();
+    return slot;
+  }
+
+  inline static std::atomic_uint64_t counter_{};
+
+  // Tells this queue from the former owners of its slot.
+  const uint64_t id_{counter_.fetch_add(1) + 1};
+  const size_t slot_{AcquireSlot()};
+  EventChannel* channel_;
+
+  alignas(64) std::atomic_uint64_t ready_{};
+  // Process() starts from this ring, so a budget doesn't starve the others.
+  size_t first_{};
+
+  std::mutex mu_;
+  // Written under mu_, a ring is published before size_ counts it.
+  std::atomic_size_t size_{};
+  std::array<std::shared_ptr<Ring>, kMaxRings> rings_;
+
+  moodycamel::ConcurrentQueue<Task> shared_;
+
+  Mailbox& internalMailbox() {
+    auto& boxes = mailboxes().boxes;
+    if (slot_ < boxes.size() && boxes[slot_].queue == id_) {
+      return boxes[slot_];
+    }
+    if (slot_ >= boxes.size()) {
+      boxes.resize(slot_ + 1);
+    }
+
+    // Drops the ring of a destroyed queue that held the slot before.
+    auto& box = boxes[slot_];
+    box = Mailbox{};
+    box.queue = id_;
+    box.index = kShared;
+
+    std::unique_lock lock(mu_);
+    size_t size = size_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < size; ++i) {
+      bool claimed = false;
+      if (rings_[i]->claimed.compare_exchange_strong(claimed, true)) {
+        box.index = i;
+        box.ring = rings_[i];
+        return box;
+      }
+    }
+    if (size < kMaxRings) {
+      box.index = size;
+      box.ring = rings_[size] = std::make_shared<Ring>();
+      size_.store(size + 1, std::memory_order_release);
+    }
+    return box;
+  }
+
+  void internalNotify(size_t index) {
+    uint64_t bit = uint64_t{1} << index;
+    if (ready_.fetch_or(bit) == 0) {
+      channel_->WakeUp();
+    }
+  }
+
+  // Runs at most max of the spilled tasks taken out of the overflow list.
+  static size_t internalDrainSpare(Ring& ring, size_t max) {
+    size_t n = std::min(max, ring.spare.size() - ring.next_spare);
+    for (size_t i = 0; i < n; ++i) {
+      ring.spare[ring.next_spare++]();
+    }
+    ring.spilled.fetch_sub(n, std::memory_order_relaxed);
+    if (ring.next_spare == ring.spare.size()) {
+      ring.spare.clear();
+      ring.next_spare = 0;
+    }
+    return n;
+  }
+
+  size_t internalDrain(Ring& ring, size_t index, size_t max) {
+    uint64_t bit = uint64_t{1} << index;
+
+    // Spilled tasks left over by the last budget are older than the ring.
+    size_t n = internalDrainSpare(ring, max);
+    if (!ring.spare.empty()) {
+      ready_.fetch_or(bit);
+      return n;
+    }
+
+    size_t head = ring.head.load(std::memory_order_relaxed);
+    size_t tail = ring.tail.load(std::memory_order_acquire);
+    for (; head != tail && n < max; ++head, ++n) {
+      Task task = std::move(ring.slots[head & kMask]);
+      ring.head.store(head + 1, std::memory_order_release);
+      task();
+    }
+
+    // Pairs with the producer reading the head after publishing its tail:
+    // either the new tasks are seen here, or the producer marks the ring.
+    ring.head.store(head);
+    if (ring.tail.load() != head) {
+      ready_.fetch_or(bit);
+      return n;
+    }
+
+    // The producer keeps spilling while the ring is marked as overflowed, so
+    // the overflow list holds the oldest tasks once the ring is empty.
+    if (!ring.overflowed.load(std::memory_order_acquire)) {
+      return n;
+    }
+    {
+      std::unique_lock lock(ring.mu);
+      ring.spare.swap(ring.overflow);
+      ring.overflowed.store(false, std::memory_order_release);
+    }
+    n += internalDrainSpare(ring, max - n);
+    if (!ring.spare.empty()) {
+      ready_.fetch_or(bit);
+    }
+    return n;
+  }
+
+  // Returns true if the ring has to be marked as ready.
+  bool internalPush(Ring& ring, Task& task) {
+    size_t tail = ring.tail.load(std::memory_order_relaxed);
+    if (!ring.overflowed.load(std::memory_order_acquire)) {
+      if (tail - ring.cached_head == kCapacity) {
+        ring.cached_head = ring.head.load(std::memory_order_acquire);
+      }
+      if (tail - ring.cached_head < kCapacity) {
+        ring.slots[tail & kMask] = std::move(task);
+        ring.tail.store(tail + 1);
+        return ring.head.load() == tail;
+      }
+    }
+
+    std::unique_lock lock(ring.mu);
+    ring.overflow.emplace_back(std::move(task));
+    ring.spilled.fetch_add(1, std::memory_order_relaxed);
+    ring.overflowed.store(true, std::memory_order_release);
+    return true;
+  }
+
+  size_t internalDrainShared(size_t max) {
+    size_t total = 0;
+    std::array<Task, 32> buf;
+    while (total < max) {
+      size_t n = std::min(buf.size(), max - total);
+      n = shared_.try_dequeue_bulk(buf.begin(), n);
+      if (n == 0) {
+        return total;
+      }
+      for (size_t i = 0; i < n; ++i) {
+        buf[i]();
+      }
+      total += n;
+    }
+
+    // Out of budget, the queue may still hold tasks.
+    ready_.fetch_or(uint64_t{1} << kShared);
+    return total;
+  }
+
+ public:
+  explicit EventSpscMeshQueue(EventChannel* channel) : channel_(channel) {}
+
+  ~EventSpscMeshQueue() override {
+    Slots& s = slots();
+    std::unique_lock lock(s.mu);
+    s.free.push_back(slot_);
+  }
+
+  void Add(Task task) override { AddBatch(&task, 1); }
+
+  void AddBatch(Task* tasks, size_t n) override {
+    if (n == 0) {
+      return;
+    }
+
+    Mailbox& box = internalMailbox();
+    Ring* ring = box.ring.get();
+    if (ring == nullptr) {
+      auto it = std::make_move_iterator(tasks);
+      while (!shared_.enqueue_bulk(it, n)) {
+        std::this_thread::yield();
+      }
+      internalNotify(kShared);
+      return;
+    }
+
+    bool notify = false;
+    for (size_t i = 0; i < n; ++i) {
+      notify |= internalPush(*ring, tasks[i]);
+    }
+    if (notify) {
+      internalNotify(box.index);
+    }
+  }
+
+  using EventQueue::Process;
+
+  size_t Process(size_t max) override {
+    size_t n = 0;
+    uint64_t ready = ready_.exchange(0);
+    uint64_t first = ready & (~uint64_t{0} << first_);
+    for (uint64_t mask : {first, ready & ~first}) {
+      while (mask != 0) {
+        size_t index = __builtin_ctzll(mask);
+        mask &= mask - 1;
+        if (n == max) {
+          ready_.fetch_or(uint64_t{1} << index);
+          continue;
+        }
+
+        if (index == kShared) {
+          n += internalDrainShared(max - n);
+        } else {
+          n += internalDrain(*rings_[index], index, max - n);
+        }
+        if (n == max) {
+          first_ = index;
+        }
+      }
+    }
+    return n;
+  }
+
+  size_t Size() override {
+    size_t n = shared_.size_approx();
+    size_t rings = size_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < rings; ++i) {
+      // The head first, so the tail read afterwards is never behind it.
+      Ring& ring = *rings_[i];
+      size_t head = ring.head.load(std::memory_order_relaxed);
+      size_t tail = ring.tail.load(std::memory_order_acquire);
+      n += tail - head + ring.spilled.load(std::memory_order_relaxed);
+    }
+    return n;
+  }
+
+  // A ring with pending tasks is marked in the ready mask.
+  bool Empty() override { return ready_.load() == 0; }
+};
+}  // namespace pedronet
+#endif  // PEDRONET_EVENT_SPSC_MESH_QUEUE_H
@@ -3,50 +3,152 @@
 
 #include <concurrentqueue.h>
 #include <pedrolib/collection/static_vector.h>
-#include <map>
+#include <algorithm>
+#include <vector>
 
 #include "pedronet/channel/timer_channel.h"
 #include "pedronet/defines.h"
 #include "pedronet/queue/timer_heap_queue.h"
 #include "pedronet/queue/timer_queue.h"
+#include "pedronet/queue/timer_slab.h"
 
 namespace pedronet {
 
 class TimerHashWheel : public TimerQueue {
 
-  struct Entry {
+  struct Link {
+    Link* prev{};
+    Link* next{};
+  };
+
+  // A circular list with a sentinel head.
+  struct List {
+    Link head;
+
+    List() { head.prev = head.next = &head; }
+    List(const List&) = delete;
+    List& operator=(const List&) = delete;
+
+    [[nodiscard]] bool Empty() const noexcept { return head.next == &head; }
+
+    void PushBack(Link* link) noexcept { InsertAfter(head.prev, link); }
+
+    Link* PopFront() noexcept {
+      Link* link = head.next;
+      Unlink(link);
+      return link;
+    }
+
+    // Moves all the links of other to the back of this list.
+    void Splice(List& other) noexcept {
+      if (other.Empty()) {
+        return;
+      }
+      other.head.next->prev = head.prev;
+      head.prev->next = other.head.next;
+      other.head.prev->next = &head;
+      head.prev = other.head.prev;
+      other.head.prev = other.head.next = &other.head;
+    }
+
+    static void InsertAfter(Link* position, Link* link) noexcept {
+      link->prev = position;
+      link->next = position->next;
+      position->next->prev = link;
+      position->next = link;
+    }
+
+    static void Unlink(Link* link) noexcept {
+      link->prev->next = link->next;
+      link->next->prev = link->prev;
+      link->prev = link->next = nullptr;
+    }
+  };
+
+  struct Entry : Link, TimerSlot {
     uint64_t rounds{};
-    uint64_t id{};
     Duration interval;
-    Callback callback;
+    Duration slack;
+    Task callback;
+    bool running{};
+    bool cancelled{};
+    // Linked into a group of a bucket rather than the expired list.
+    bool grouped{};
+    uint32_t bucket{};
+#ifdef PEDRONET_METRICS
+    Timestamp expire;
+#endif
   };
 
+  // The timers of a bucket grouped by rounds, the groups are kept in order of
+  // rounds so a pop stops at the first group that is not due. The vector
+  // keeps its capacity, so adding a timer allocates nothing in steady state.
   class Bucket {
-    mutable SpinLock mu_{};
-    std::map<uint64_t, std::vector<uint64_t>> queue_;
+    // The timers of a group are linked from first to last, with null at
+    // both ends.
+    struct Group {
+      uint64_t rounds;
+      Link* first;
+      Link* last;
+    };
+
+    std::vector<Group> groups_;
+
+    auto internalFind(uint64_t rounds) noexcept {
+      return std::lower_bound(
+          groups_.begin(), groups_.end(), rounds,
+          [](const Group& group, uint64_t r) { return group.rounds < r; });
+    }
 
    public:
-    void Add(uint64_t rounds, uint64_t id) {
-      std::lock_guard guard{mu_};
-      queue_[rounds].emplace_back(id);
+    void Add(Entry* entry) {
+      entry->grouped = true;
+      entry->next = nullptr;
+
+      // Timers added later mostly expire later.
+      auto it = groups_.end();
+      if (!groups_.empty() && groups_.back().rounds >= entry->rounds) {
+        it = internalFind(entry->rounds);
+      }
+      if (it == groups_.end() || it->rounds != entry->rounds) {
+        entry->prev = nullptr;
+        groups_.insert(it, Group{entry->rounds, entry, entry});
+        return;
+      }
+      entry->prev = it->last;
+      it->last->next = entry;
+      it->last = entry;
     }
 
-    bool Pop(uint64_t rounds, std::vector<uint64_t>& entry) {
-      std::unique_lock lock{mu_};
-
-      while (true) {
-        auto it = queue_.begin();
-        if (it == queue_.end()) {
-          return false;
+    // Moves the timers due by the given rounds to the back of expired.
+    void Pop(uint64_t rounds, List& expired) noexcept {
+      auto it = groups_.begin();
+      for (; it != groups_.end() && it->rounds <= rounds; ++it) {
+        for (Link* link = it->first; link != nullptr; link = link->next) {
+          static_cast<Entry*>(link)->grouped = false;
         }
+        it->first->prev = expired.head.prev;
+        expired.head.prev->next = it->first;
+        it->last->next = &expired.head;
+        expired.head.prev = it->last;
+      }
+      groups_.erase(groups_.begin(), it);
+    }
 
-        if (it->first > rounds) {
-          return false;
-        }
+    // Unlinks the entry from its group or from the expired list.
+    void Remove(Entry* entry) noexcept {
+      if (!entry->grouped) {
+        List::Unlink(entry);
+        return;
+      }
 
-        entry = std::move(it->second);
-        queue_.erase(it);
-        return true;
+      entry->grouped = false;
+      auto it = internalFind(entry->rounds);
+      (entry->prev != nullptr ? entry->prev->next : it->first) = entry->next;
+      (entry->next != nullptr ? entry->next->prev : it->last) = entry->prev;
+      entry->prev = entry->next = nullptr;
+      if (it->first == nullptr) {
+        groups_.erase(it);
       }
     }
   };
@@ -59,50 +161,62 @@ class TimerHashWheel : public TimerQueue {
     return ts.usecs / tick_.usecs / buckets_.size();
   }
 
-  std::shared_ptr<Entry> GetEntry(uint64_t id) {
-    std::lock_guard guard{mu_};
-    auto it = table_.find(id);
-    if (it == table_.end()) {
-      return nullptr;
-    }
-    return it->second;
+  void Place(Entry* entry, Timestamp expire) {
+    entry->rounds = GetRounds(expire);
+#ifdef PEDRONET_METRICS
+    entry->expire = expire;
+#endif
+    entry->bucket = GetTicks(expire) % buckets_.size();
+    buckets_[entry->bucket].Add(entry);
   }
 
-  void SetEntry(uint64_t id, std::shared_ptr<Entry> entry) {
-    std::lock_guard guard{mu_};
-    table_[id] = std::move(entry);
+  void Free(Entry* entry) {
+    entry->callback = nullptr;
+    entry->running = false;
+    entry->cancelled = false;
+    slab_.Free(entry);
   }
 
-  void ProcessBuckets(Timestamp now, size_t source_bucket,
-                      size_t target_bucket) {
-    uint64_t rounds = GetRounds(now);
-    std::vector<uint64_t> entries;
-
-    for (size_t i = source_bucket; i <= target_bucket; ++i) {
-      auto& bucket = buckets_[i];
-      entries.clear();
-      while (bucket.Pop(rounds, entries)) {
-        for (auto& id : entries) {
-          auto timer = GetEntry(id);
-          if (timer == nullptr) {
-            continue;
-          }
-
-          if (timer->interval <= Duration::Zero()) {
-            Cancel(id);
-          } else {
-            Timestamp expire = now + timer->interval;
-            uint64_t ticks = GetTicks(expire);
-            timer->rounds = GetRounds(expire);
-            buckets_[ticks % buckets_.size()].Add(timer->rounds, timer->id);
-          }
-
-          timer->callback();
-        }
+  // Every tick pops its bucket with its own rounds, the buckets passed
+  // before the wheel wrapped around belong to the rounds before.
+  void CollectBuckets(uint64_t first_tick, uint64_t last_tick) {
+    for (uint64_t tick = first_tick; tick <= last_tick; ++tick) {
+      buckets_[tick % buckets_.size()].Pop(tick / buckets_.size(), expired_);
+    }
+  }
+
+  // Timers are run one by one off expired_, so a callback may cancel any of
+  // the others.
+  void ProcessExpired(Timestamp now) {
+    while (!expired_.Empty()) {
+      auto* timer = static_cast<Entry*>(expired_.PopFront());
+      timer->running = true;
+#ifdef PEDRONET_METRICS
+      RecordLag(timer->expire);
+#endif
+      timer->callback();
+
+      timer->running = false;
+      if (timer->interval > Duration::Zero() && !timer->cancelled) {
+        Place(timer, ApplySlack(now + timer->interval, timer->slack));
+      } else {
+        Free(timer);
       }
     }
   }
 
+  Entry* Insert(Timestamp expired, Duration interval, Duration slack,
+                Task callback) {
+    Entry* entry = slab_.Allocate();
+    entry->interval = interval;
+    entry->slack = slack;
+    entry->callback = std::move(callback);
+    Place(entry, expired);
+
+    WakeUp(expired);
+    return entry;
+  }
+
   void WakeUp(Timestamp expire) {
     expire.usecs = expire.usecs / tick_.usecs * tick_.usecs;
     channel_->WakeUpAt(expire);
@@ -115,8 +229,8 @@ class TimerHashWheel : public TimerQueue {
   };
 
   TimerHashWheel(TimerChannel* channel, const Options& options)
-      : tick_(options.tick),
-        channel_(channel),
+      : TimerQueue(channel),
+        tick_(options.tick),
         last_(Timestamp::Now()),
         buckets_(options.buckets) {
     for (int i = 0; i < buckets_.capacity(); ++i) {
@@ -128,65 +242,59 @@ class TimerHashWheel : public TimerQueue {
   explicit TimerHashWheel(TimerChannel* channel)
       : TimerHashWheel(channel, Options{}) {}
 
-  uint64_t Add(Duration delay, Duration interval, Callback callback) override {
-    uint64_t id = counter_.fetch_add(1, std::memory_order_relaxed) + 1;
-
-    Timestamp expired = Timestamp::Now() + delay;
-    uint64_t ticks = GetTicks(expired);
-    uint64_t rounds = GetRounds(expired);
-    size_t b = ticks % buckets_.size();
-
-    auto entry = std::make_shared<Entry>();
-    entry->id = id;
-    entry->rounds = rounds;
-    entry->interval = interval;
-    entry->callback = std::move(callback);
-
-    SetEntry(id, std::move(entry));
-    buckets_[b].Add(rounds, id);
-
-    WakeUp(expired);
-    return id;
-  }
-
-  void Cancel(uint64_t id) override {
-    std::lock_guard guard{mu_};
-    table_.erase(id);
+  uint64_t Add(Duration delay, Duration interval, Duration slack,
+               Task callback) override {
+    Timestamp expire = ApplySlack(Timestamp::Now() + delay, slack);
+    return slab_.GetId(Insert(expire, interval, slack, std::move(callback)));
   }
 
   void Process() override {
+    internalDrainStaged();
     Timestamp now = Timestamp::Now();
     uint64_t t1 = GetTicks(last_);
     uint64_t t2 = GetTicks(now);
 
-    if (t2 - t1 < buckets_.size()) {
-      size_t b1 = t1 % buckets_.size();
-      size_t b2 = t2 % buckets_.size();
-      if (b1 <= b2) {
-        ProcessBuckets(now, b1, b2);
-      } else {
-        ProcessBuckets(now, b1, buckets_.size() - 1);
-        ProcessBuckets(now, 0, b2);
-      }
-    } else {
-      ProcessBuckets(now, 0, buckets_.size() - 1);
+    // A bucket visited at its latest tick pops the older rounds as well.
+    if (t2 - t1 >= buckets_.size()) {
+      t1 = t2 - buckets_.size() + 1;
     }
+    CollectBuckets(t1, t2);
+    ProcessExpired(now);
 
     last_ = now;
     WakeUp(now + tick_);
   }
 
  private:
+  void internalAdd(uint64_t id, Timestamp expired, Duration interval,
+                   Duration slack, Task callback) override {
+    slab_.Alias(Insert(expired, interval, slack, std::move(callback)), id);
+  }
+
+  void internalCancel(uint64_t id) override {
+    Entry* entry = slab_.Find(id);
+    if (entry == nullptr) {
+      return;
+    }
+
+    // A running timer is released by ProcessExpired() once it returns.
+    if (entry->running) {
+      entry->cancelled = true;
+      return;
+    }
+    buckets_[entry->bucket].Remove(entry);
+    Free(entry);
+  }
+
   const Duration tick_;
-  TimerChannel* channel_;
 
   Timestamp last_{};
-  std::atomic_uint64_t counter_{};
 
   pedrolib::StaticVector<Bucket> buckets_;
+  // Timers due in the ticks being processed.
+  List expired_;
 
-  SpinLock mu_;
-  std::unordered_map<uint64_t, std::shared_ptr<Entry>> table_;
+  TimerSlab<Entry> slab_;
 };
 }  // namespace pedronet
 
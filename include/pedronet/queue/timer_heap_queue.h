@@ -2,53 +2,68 @@
 #define PEDRONET_QUEUE_TIMER_QUEUE
 
 #include <pedrolib/executor/executor.h>
-#include <queue>
+#include <limits>
+#include <vector>
 #include "pedronet/channel/timer_channel.h"
 #include "pedronet/queue/timer_queue.h"
+#include "pedronet/queue/timer_slab.h"
 
 namespace pedronet {
 
 
+// An indexed 4-ary min-heap stored in one vector. Every entry tracks the
+// position of its node, so a cancel removes the node right away and a
+// periodic timer is sifted down in place instead of pushed again. The
+// entries themselves live in a TimerSlab.
 class TimerHeapQueue final : public TimerQueue {
+  static constexpr size_t kArity = 4;
+  static constexpr uint32_t kNoPosition = std::numeric_limits<uint32_t>::max();
 
-  struct Entry {
-    uint64_t id;
-    Callback callback;
+  struct Entry : TimerSlot {
+    Task callback;
     Duration interval;
-
-    Entry(uint64_t id, Callback callback, const Duration& interval)
-        : id(id), callback(std::move(callback)), interval(interval) {}
+    Duration slack;
+    bool running{};
+    bool cancelled{};
   };
 
-  struct Timeout {
+  struct Node {
     Timestamp expire;
-    mutable std::weak_ptr<Entry> timer;
+    // The slab index of the entry.
+    uint32_t entry;
+  };
 
-    Timeout(Timestamp expire, const std::weak_ptr<Entry>& timer)
-        : expire(expire), timer(timer) {}
+  Entry* internalInsert(Timestamp expire, Duration interval, Duration slack,
+                        Task callback);
+  void internalFree(Entry* entry);
 
-    bool operator<(const Timeout& other) const noexcept {
-      return expire > other.expire;
-    }
-  };
+  void internalPlace(size_t position, Node node) noexcept {
+    heap_[position] = node;
+    positions_[node.entry] = position;
+  }
+
+  void internalSiftUp(size_t position) noexcept;
+  void internalSiftDown(size_t position) noexcept;
+  void internalRemove(size_t position) noexcept;
+
+  void internalAdd(uint64_t id, Timestamp expire, Duration interval,
+                   Duration slack, Task callback) override;
+
+  void internalCancel(uint64_t id) override;
 
  public:
-  explicit TimerHeapQueue(TimerChannel* channel) : channel_(channel) {}
+  explicit TimerHeapQueue(TimerChannel* channel) : TimerQueue(channel) {}
 
-  uint64_t Add(Duration delay, Duration interval, Callback callback) override;
+  uint64_t Add(Duration delay, Duration interval, Duration slack,
+               Task callback) override;
 
   void Process() override;
 
-  void Cancel(uint64_t timer_id) override;
-
  private:
-  TimerChannel* channel_;
-  std::atomic_uint64_t counter_{};
-  std::queue<std::shared_ptr<const Entry>> expires_;
-
-  SpinLock mu_;
-  std::priority_queue<Timeout> queue_;
-  std::unordered_map<uint64_t, std::shared_ptr<const Entry>> table_;
+  std::vector<Node> heap_;
+  TimerSlab<Entry> slab_;
+  // Apart from the entries, so sifting a node touches less memory.
+  std::vector<uint32_t> positions_;
 };
 }  // namespace pedronet
 #endif  // PEDRONET_TIMER_QUEUE
\ No newline at end of file
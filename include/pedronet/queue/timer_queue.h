@@ -1,16 +1,152 @@
 #ifndef PEDRONET_QUEUE_TIMER_QUEUE_H
 #define PEDRONET_QUEUE_TIMER_QUEUE_H
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
 #include "pedronet/callbacks.h"
+#include "pedronet/channel/timer_channel.h"
 #include "pedronet/defines.h"
+#include "pedronet/metrics.h"
+#include "pedronet/task.h"
 
 namespace pedronet {
+
+// A timer queue belongs to the thread of its event loop: Add(), Cancel() and
+// Process() are only called from there and take no locks. Other threads go
+// through Stage() and StageCancel(), which push onto a lock-free stack that
+// Process() drains before it expires anything.
+//
+// Ids stay below 2^48, EventLoopGroup folds the loop index into them.
 struct TimerQueue {
-  virtual ~TimerQueue() = default;
-  virtual uint64_t Add(Duration delay, Duration interval,
-                       Callback callback) = 0;
-  virtual void Cancel(uint64_t id) = 0;
+  explicit TimerQueue(TimerChannel* channel) : channel_(channel) {}
+
+  virtual ~TimerQueue() {
+    Staged* staged = staged_.exchange(nullptr);
+    while (staged != nullptr) {
+      delete std::exchange(staged, staged->next);
+    }
+  }
+
+  virtual uint64_t Add(Duration delay, Duration interval, Duration slack,
+                       Task task) = 0;
+
+  void Cancel(uint64_t id) {
+    // The timer may still wait in the stack.
+    if (id & kStaged) {
+      internalDrainStaged();
+    }
+    internalCancel(id);
+  }
+
   virtual void Process() = 0;
+
+  uint64_t Stage(Duration delay, Duration interval, Duration slack,
+                 Task task) {
+    Timestamp expire = ApplySlack(Timestamp::Now() + delay, slack);
+    uint64_t id = kStaged | (ids_.fetch_add(1, std::memory_order_relaxed) + 1);
+    internalPush(new Staged{id, expire, interval, slack, std::move(task)});
+    channel_->WakeUpAt(expire);
+    return id;
+  }
+
+  void StageCancel(uint64_t id) {
+    auto staged = new Staged{id};
+    staged->cancel = true;
+    internalPush(staged);
+  }
+
+#ifdef PEDRONET_METRICS
+  // Receives the fire time minus the deadline of every timer.
+  void SetLagHistogram(Histogram* lag) noexcept { lag_ = lag; }
+#endif
+
+ protected:
+  // Tags the ids handed out by Stage().
+  static constexpr uint64_t kStaged = uint64_t{1} << 47;
+
+  // The time in [expire, expire + slack] with the most trailing zero bits,
+  // so timers whose windows overlap mostly get the same deadline and share
+  // a wakeup of the loop.
+  static Timestamp ApplySlack(Timestamp expire, Duration slack) noexcept {
+    if (slack <= Duration::Zero()) {
+      return expire;
+    }
+    auto earliest = static_cast<uint64_t>(expire.usecs);
+    uint64_t latest = earliest + slack.Microseconds();
+    int bit = 63 - __builtin_clzll(earliest ^ latest);
+    latest &= ~((uint64_t{1} << bit) - 1);
+    return Timestamp{static_cast<int64_t>(latest)};
+  }
+
+  // Inserts a staged timer under the id Stage() returned, its first deadline
+  // has the slack applied already.
+  virtual void internalAdd(uint64_t id, Timestamp expire, Duration interval,
+                           Duration slack, Task task) = 0;
+  virtual void internalCancel(uint64_t id) = 0;
+
+  // Applies the staged adds and cancels in the order they were made.
+  void internalDrainStaged() {
+    if (staged_.load(std::memory_order_relaxed) == nullptr) {
+      return;
+    }
+
+    // The stack hands them out newest first.
+    Staged* staged = staged_.exchange(nullptr, std::memory_order_acquire);
+    Staged* list = nullptr;
+    while (staged != nullptr) {
+      Staged* next = staged->next;
+      staged->next = list;
+      list = staged;
+      staged = next;
+    }
+
+    while (list != nullptr) {
+      std::unique_ptr<Staged> op(std::exchange(list, list->next));
+      if (op->cancel) {
+        internalCancel(op->id);
+      } else {
+        internalAdd(op->id, op->expire, op->interval, op->slack,
+                    std::move(op->task));
+      }
+    }
+  }
+
+#ifdef PEDRONET_METRICS
+  void RecordLag(Timestamp deadline) {
+    if (lag_ != nullptr) {
+      int64_t us = (Timestamp::Now() - deadline).Microseconds();
+      lag_->Record(std::max<int64_t>(us, 0));
+    }
+  }
+
+  Histogram* lag_{};
+#endif
+
+  TimerChannel* channel_;
+
+ private:
+  struct Staged {
+    uint64_t id{};
+    Timestamp expire;
+    Duration interval;
+    Duration slack;
+    Task task;
+    bool cancel{};
+    Staged* next{};
+  };
+
+  void internalPush(Staged* staged) {
+    staged->next = staged_.load(std::memory_order_relaxed);
+    while (!staged_.compare_exchange_weak(staged->next, staged,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed)) {
+    }
+  }
+
+  std::atomic<Staged*> staged_{};
+  std::atomic_uint64_t ids_{};
 };
 }  // namespace pedronet
 #endif  //PEDRONET_QUEUE_TIMER_QUEUE_H
@@ -2,6 +2,7 @@
 #define PEDRONET_QUEUE_TIMER_QUEUE_FACTORY_H
 #include "pedronet/queue/timer_hash_wheel.h"
 #include "pedronet/queue/timer_heap_queue.h"
+#include "pedronet/queue/timer_wheel.h"
 #include "pedronet/options.h"
 
 namespace pedronet {
@@ -13,6 +14,8 @@ inline static std::unique_ptr<TimerQueue> MakeTimerQueue(TimerQueueType type,
       return std::make_unique<TimerHashWheel>(channel);
     case TimerQueueType::kHeap:
       return std::make_unique<TimerHeapQueue>(channel);
+    case TimerQueueType::kHierarchicalWheel:
+      return std::make_unique<TimerWheel>(channel);
     default:
       return nullptr;
   }
@@ -0,0 +1,127 @@
+#ifndef PEDRONET_QUEUE_TIMER_SLAB_H
+#define PEDRONET_QUEUE_TIMER_SLAB_H
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pedronet/logger/logger.h"
+
+namespace pedronet {
+
+// The fields a TimerSlab keeps in every entry.
+struct TimerSlot {
+  uint32_t index{};
+  uint32_t generation{};
+  bool used{};
+  TimerSlot* free{};
+  // See TimerSlab::Alias().
+  uint64_t alias{};
+};
+
+// The timer entries of one queue, allocated in chunks that never move and
+// recycled through a free list, so adding a timer allocates nothing once the
+// queue has seen as many timers at a time before.
+//
+// The id of an entry is its generation above its index plus one. A free
+// bumps the generation, which turns the ids handed out so far stale and makes
+// a cancel a direct lookup. Ids stay below 2^47, see TimerQueue.
+//
+// The ids at or above 2^47 are aliases, they are handed out before the entry
+// exists and are found through a map.
+template <typename Entry>
+class TimerSlab {
+  static constexpr size_t kChunkBits = 10;
+  static constexpr size_t kChunkSize = size_t{1} << kChunkBits;
+  static constexpr size_t kIndexBits = 27;
+  static constexpr uint64_t kIndexMask = (uint64_t{1} << kIndexBits) - 1;
+  static constexpr uint64_t kGenerationMask = (uint64_t{1} << 20) - 1;
+  static constexpr uint64_t kAlias = uint64_t{1} << (kIndexBits + 20);
+
+ public:
+  Entry* Allocate() {
+    if (free_ == nullptr) {
+      internalGrow();
+    }
+    auto* entry = static_cast<Entry*>(free_);
+    free_ = entry->free;
+    entry->free = nullptr;
+    entry->used = true;
+    return entry;
+  }
+
+  // The entry must be reset by the caller.
+  void Free(Entry* entry) noexcept {
+    if (entry->alias != 0) {
+      aliases_.erase(std::exchange(entry->alias, 0));
+    }
+    entry->used = false;
+    entry->generation++;
+    entry->free = free_;
+    free_ = entry;
+  }
+
+  [[nodiscard]] uint64_t GetId(const Entry* entry) const noexcept {
+    uint64_t generation = entry->generation & kGenerationMask;
+    return generation << kIndexBits | (entry->index + 1);
+  }
+
+  // Lets the entry be found by an id at or above 2^47 as well.
+  void Alias(Entry* entry, uint64_t id) {
+    entry->alias = id;
+    aliases_.emplace(id, entry);
+  }
+
+  // The entry of an id, or nullptr if the id is stale.
+  [[nodiscard]] Entry* Find(uint64_t id) const noexcept {
+    if (id >= kAlias) {
+      auto it = aliases_.find(id);
+      return it != aliases_.end() ? it->second : nullptr;
+    }
+
+    uint64_t index = (id & kIndexMask) - 1;
+    if (index >= Capacity()) {
+      return nullptr;
+    }
+    Entry* entry = &Get(index);
+    uint64_t generation = entry->generation & kGenerationMask;
+    if (!entry->used || generation != id >> kIndexBits) {
+      return nullptr;
+    }
+    return entry;
+  }
+
+  [[nodiscard]] Entry& Get(size_t index) const noexcept {
+    return chunks_[index >> kChunkBits][index & (kChunkSize - 1)];
+  }
+
+  [[nodiscard]] size_t Capacity() const noexcept {
+    return chunks_.size() << kChunkBits;
+  }
+
+ private:
+  void internalGrow() {
+    if (Capacity() + kChunkSize > kIndexMask) {
+      PEDRONET_FATAL("too many timers");
+    }
+
+    auto chunk = std::make_unique<Entry[]>(kChunkSize);
+    auto base = static_cast<uint32_t>(Capacity());
+    for (size_t i = kChunkSize; i-- > 0;) {
+      chunk[i].index = base + i;
+      chunk[i].free = free_;
+      free_ = &chunk[i];
+    }
+    chunks_.emplace_back(std::move(chunk));
+  }
+
+  std::vector<std::unique_ptr<Entry[]>> chunks_;
+  TimerSlot* free_{};
+  std::unordered_map<uint64_t, Entry*> aliases_;
+};
+
+}  // namespace pedronet
+
+#endif  // PEDRONET_QUEUE_TIMER_SLAB_H
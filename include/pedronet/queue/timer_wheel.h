@@ -0,0 +1,154 @@
+#ifndef PEDRONET_QUEUE_TIMER_WHEEL_H
+#define PEDRONET_QUEUE_TIMER_WHEEL_H
+
+#include <array>
+#include <cstdint>
+
+#include "pedronet/channel/timer_channel.h"
+#include "pedronet/defines.h"
+#include "pedronet/queue/timer_queue.h"
+#include "pedronet/queue/timer_slab.h"
+
+namespace pedronet {
+
+// A hierarchical timing wheel: kLevels wheels of kSlots slots each, a slot of
+// level l spans kSlots^l ticks. A timer is linked into the slot of the
+// coarsest level it fits into, and cascades down one or more levels when the
+// wheel reaches that slot. Insert, cancel and expire are O(1).
+//
+// Timers are intrusive entries of a TimerSlab, so a cancel never looks up a
+// table. The occupancy of every level is kept as a bitmap to skip over empty
+// slots.
+class TimerWheel final : public TimerQueue {
+  static constexpr size_t kSlotBits = 6;
+  static constexpr size_t kSlots = size_t{1} << kSlotBits;
+  static constexpr size_t kLevels = 6;
+  // Later timers are parked at the end of the wheel and relinked from there.
+  static constexpr uint64_t kMaxDelta =
+      (uint64_t{1} << (kSlotBits * kLevels)) - 1;
+
+  enum class State : uint8_t { kFree, kLinked, kRunning };
+
+  struct Link {
+    Link* prev{};
+    Link* next{};
+  };
+
+  struct Entry : Link, TimerSlot {
+    // Deadline in ticks.
+    uint64_t expire{};
+    Duration interval;
+    Duration slack;
+    Task callback;
+    State state{State::kFree};
+    bool cancelled{};
+    // Where the entry is linked.
+    uint8_t level{};
+    uint8_t slot{};
+  };
+
+  // A circular list with a sentinel head.
+  struct Slot {
+    Link head;
+
+    Slot() { head.prev = head.next = &head; }
+    Slot(const Slot&) = delete;
+    Slot& operator=(const Slot&) = delete;
+
+    [[nodiscard]] bool Empty() const noexcept { return head.next == &head; }
+
+    void PushBack(Link* link) noexcept {
+      link->prev = head.prev;
+      link->next = &head;
+      head.prev->next = link;
+      head.prev = link;
+    }
+
+    Entry* PopFront() noexcept {
+      auto* entry = static_cast<Entry*>(head.next);
+      Unlink(entry);
+      return entry;
+    }
+
+    // Moves all the links of other to the back of this list.
+    void Splice(Slot& other) noexcept {
+      if (other.Empty()) {
+        return;
+      }
+      other.head.next->prev = head.prev;
+      head.prev->next = other.head.next;
+      other.head.prev->next = &head;
+      head.prev = other.head.prev;
+      other.head.prev = other.head.next = &other.head;
+    }
+
+    static void Unlink(Link* link) noexcept {
+      link->prev->next = link->next;
+      link->next->prev = link->prev;
+      link->prev = link->next = nullptr;
+    }
+  };
+
+  struct Level {
+    uint64_t occupied{};
+    std::array<Slot, kSlots> slots;
+  };
+
+  [[nodiscard]] uint64_t GetTicks(Timestamp ts) const noexcept {
+    return ts.usecs / tick_.usecs;
+  }
+
+  // Rounded up, so a timer never fires early.
+  [[nodiscard]] uint64_t GetDeadline(Timestamp ts) const noexcept {
+    return (ts.usecs + tick_.usecs - 1) / tick_.usecs;
+  }
+
+  [[nodiscard]] Timestamp GetTimestamp(uint64_t ticks) const noexcept {
+    return Timestamp{static_cast<int64_t>(ticks * tick_.usecs)};
+  }
+
+  void internalFree(Entry* entry);
+  Entry* internalInsert(Timestamp expire, Duration interval, Duration slack,
+                        Task callback);
+
+  // Links the entry no earlier than the given tick.
+  void internalLink(Entry* entry, uint64_t earliest);
+  void internalUnlink(Entry* entry);
+  void internalCascade(size_t level);
+  [[nodiscard]] uint64_t internalNextTick() const noexcept;
+
+  void internalAdd(uint64_t id, Timestamp expire, Duration interval,
+                   Duration slack, Task callback) override;
+  void internalCancel(uint64_t id) override;
+
+ public:
+  struct Options {
+    Duration tick = Duration::Milliseconds(1);
+  };
+
+  TimerWheel(TimerChannel* channel, const Options& options);
+
+  explicit TimerWheel(TimerChannel* channel)
+      : TimerWheel(channel, Options{}) {}
+
+  uint64_t Add(Duration delay, Duration interval, Duration slack,
+               Task callback) override;
+
+  void Process() override;
+
+ private:
+  const Duration tick_;
+
+  // Every timer due at or before now_ has been expired.
+  uint64_t now_;
+  // The tick the channel is armed for at the latest.
+  uint64_t armed_{UINT64_MAX};
+  std::array<Level, kLevels> levels_;
+  // Timers due in the tick being processed.
+  Slot expired_;
+  TimerSlab<Entry> slab_;
+};
+
+}  // namespace pedronet
+
+#endif  // PEDRONET_QUEUE_TIMER_WHEEL_H
@@ -6,15 +6,29 @@
 #include "pedronet/event.h"
 #include "pedronet/selector/selector.h"
 
-#include <unordered_set>
+#include <atomic>
+#include <unordered_map>
 #include <vector>
 
 struct epoll_event;
 
 namespace pedronet {
 
+// Registered channels live in a slot table. The slot index and its generation
+// are stored in epoll_event.data, so dispatching an event is a plain index,
+// and the events of a removed channel are rejected by the generation.
 class EpollSelector : public Selector {
-  void internalUpdate(Channel* channel, int op, SelectEvents events);
+  struct Slot {
+    Channel::Ptr channel;
+    uint32_t generation{};
+    bool dirty{};
+    SelectEvents events;
+    SelectEvents pending;
+  };
+
+  int internalWait(Duration timeout);
+  void internalUpdate(Channel* channel, uint64_t id, int op,
+                      SelectEvents events);
 
  public:
   EpollSelector();
@@ -26,6 +40,15 @@ class EpollSelector : public Selector {
 
   bool Contain(const Channel::Ptr& channel) const noexcept override;
 
+  void Flush() override;
+  [[nodiscard]] uint64_t Updates() const noexcept override {
+    return updates_.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] bool Supports(SelectTrigger trigger) const noexcept override {
+    return true;
+  }
+
   Error Wait(Duration timeout) override;
   [[nodiscard]] size_t Size() const override;
   [[nodiscard]] SelectChannel Get(size_t index) const override;
@@ -34,7 +57,13 @@ class EpollSelector : public Selector {
   File fd_;
   size_t len_{};
   std::vector<struct epoll_event> buf_;
-  std::unordered_map<Channel*, Channel::Ptr> channel_;
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_;
+  std::vector<uint32_t> dirty_;
+  std::vector<Channel::Ptr> released_;
+  std::unordered_map<Channel*, uint64_t> channel_;
+  std::atomic<uint64_t> updates_{};
+  bool pwait2_{true};
 };
 }  // namespace pedronet
 
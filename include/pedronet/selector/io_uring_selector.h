@@ -0,0 +1,108 @@
+#ifndef PEDRONET_SELECTOR_IO_URING_SELECTOR_H
+#define PEDRONET_SELECTOR_IO_URING_SELECTOR_H
+
+#include "pedrolib/file/file.h"
+#include "pedronet/channel/channel.h"
+#include "pedronet/event.h"
+#include "pedronet/selector/selector.h"
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace pedronet {
+
+// A selector driven by io_uring(7). Every registered channel keeps an oneshot
+// IORING_OP_POLL_ADD armed, which preserves the level-triggered semantic of
+// the other selectors. Arming, updating and removing polls only prepare
+// submission entries, they are submitted together with the wait in a single
+// io_uring_enter(2) per EventLoop::Loop() iteration. Interest changes are
+// coalesced until Flush(), so a channel gets at most one poll update per
+// iteration.
+//
+// On Linux 6.0+ a channel may also keep a multishot accept or receive armed,
+// received bytes land in a provided buffer ring shared by all connections of
+// the loop and are handed out as completions.
+class IoUringSelector : public Selector {
+  struct Ring;
+  struct BufferRing;
+
+  struct Entry {
+    Channel::Ptr channel;
+    SelectEvents events;
+    SelectEvents armed_events;
+    SelectOperation operation{};
+    bool armed{};
+    bool submitted{};
+    bool dirty{};
+  };
+
+  struct Ready {
+    Entry* entry;
+    ReceiveEvents events;
+    SelectCompletion completion;
+  };
+
+  Entry* internalAllocate();
+  io_uring_sqe* internalPrepare();
+  void internalArm(Entry* entry);
+  void internalSubmit(Entry* entry);
+  bool internalOperate(Channel* channel, SelectOperation operation);
+  void internalComplete(Entry* entry, const io_uring_cqe& cqe);
+  void internalRelease(Entry* entry);
+  int internalEnter(unsigned wait, Duration timeout);
+  void internalReap();
+
+ public:
+  IoUringSelector();
+  ~IoUringSelector() override;
+
+  // Whether the running kernel provides the io_uring features this selector
+  // relies on (Linux 5.13+).
+  static bool Supported() noexcept;
+
+  // Whether multishot accept, multishot receive and provided buffer rings are
+  // available (Linux 6.0+).
+  static bool SupportedCompletion() noexcept;
+
+  void Add(const Channel::Ptr& channel, SelectEvents events) override;
+  void Remove(const Channel::Ptr& channel) override;
+  void Update(Channel* channel, SelectEvents events) override;
+
+  bool Contain(const Channel::Ptr& channel) const noexcept override;
+
+  bool Accept(Channel* channel) override;
+  bool Receive(Channel* channel) override;
+
+  void Flush() override;
+  [[nodiscard]] uint64_t Updates() const noexcept override {
+    return updates_.load(std::memory_order_relaxed);
+  }
+
+  Error Wait(Duration timeout) override;
+  [[nodiscard]] size_t Size() const override;
+  [[nodiscard]] SelectChannel Get(size_t index) const override;
+  [[nodiscard]] const SelectCompletion& GetCompletion(
+      size_t index) const override;
+
+ private:
+  std::unique_ptr<Ring> ring_;
+  std::unique_ptr<BufferRing> buffers_;
+
+  std::vector<Ready> ready_;
+  std::vector<Entry*> resubmit_;
+  std::vector<Entry*> dirty_;
+  std::vector<Channel::Ptr> released_;
+  std::vector<Entry*> garbage_;
+  std::vector<Entry*> free_;
+  std::vector<std::unique_ptr<Entry>> entries_;
+  std::unordered_map<Channel*, Entry*> channels_;
+  std::atomic<uint64_t> updates_{};
+};
+}  // namespace pedronet
+
+#endif  // PEDRONET_SELECTOR_IO_URING_SELECTOR_H
@@ -6,30 +6,40 @@
 #include "pedronet/event.h"
 #include "pedronet/selector/selector.h"
 
-#include <sys/poll.h>
+#include <poll.h>
+#include <algorithm>
 #include <vector>
 
 namespace pedronet {
 
+// The pollfd array is dense and is never reordered by Wait(), the slot of a
+// descriptor knows its position in it. Removing a channel moves the last
+// pollfd into the hole. Ready descriptors are collected into a separate list
+// together with the generation of their slot, so a channel removed (or a
+// descriptor reused) while the events are dispatched is skipped.
 class Poller : public Selector {
-  using Locator = std::pair<size_t, Channel::Ptr>;
+  struct Slot {
+    Channel::Ptr channel;
+    size_t position{};
+    uint32_t generation{};
+  };
+
+  struct Ready {
+    int fd{};
+    uint32_t generation{};
+    ReceiveEvents events;
+  };
 
-  bool cleanable_{};
   std::vector<struct pollfd> buf_;
-  size_t ready_{};
-  std::unordered_map<int, Locator> channels_;
+  std::vector<Slot> slots_;
+  std::vector<Ready> ready_;
+  std::vector<Channel::Ptr> released_;
 
-  void CleanUp() {
-    size_t head = 0;
-    for (auto& p : buf_) {
-      if (channels_.count(p.fd) == 0) {
-        continue;
-      }
-
-      buf_[head] = p;
-      channels_[p.fd].first = head++;
+  Slot* internalFind(int fd) noexcept {
+    if (fd < 0 || (size_t)fd >= slots_.size() || !slots_[fd].channel) {
+      return nullptr;
     }
-    buf_.resize(head);
+    return &slots_[fd];
   }
 
  public:
@@ -38,62 +48,86 @@ class Poller : public Selector {
   ~Poller() override = default;
 
   void Add(const Channel::Ptr& channel, SelectEvents events) override {
+    int fd = channel->GetFile().Descriptor();
+    if ((size_t)fd >= slots_.size()) {
+      slots_.resize(fd + 1);
+    }
+
     auto& pfd = buf_.emplace_back();
-    pfd.fd = channel->GetFile().Descriptor();
+    pfd.fd = fd;
     pfd.events = (short)events.Value();
     pfd.revents = 0;
-    channels_[pfd.fd] = {buf_.size() - 1, channel};
+
+    Slot& slot = slots_[fd];
+    slot.channel = channel;
+    slot.position = buf_.size() - 1;
   }
 
   void Remove(const Channel::Ptr& channel) override {
-    int fd = channel->GetFile().Descriptor();
-    auto it = channels_.find(fd);
-    if (it != channels_.end()) {
-      channels_.erase(it);
-      cleanable_ = true;
+    Slot* slot = internalFind(channel->GetFile().Descriptor());
+    if (slot == nullptr) {
+      return;
     }
+
+    released_.emplace_back(std::move(slot->channel));
+    slot->channel = nullptr;
+    slot->generation++;
+
+    size_t position = slot->position;
+    buf_[position] = buf_.back();
+    slots_[buf_[position].fd].position = position;
+    buf_.pop_back();
   }
 
   void Update(Channel* channel, SelectEvents events) override {
-    int fd = channel->GetFile().Descriptor();
-    auto it = channels_.find(fd);
-    if (it != channels_.end()) {
-      buf_[it->second.first].events = (short)events.Value();
+    Slot* slot = internalFind(channel->GetFile().Descriptor());
+    if (slot != nullptr) {
+      buf_[slot->position].events = (short)events.Value();
     }
   }
 
   bool Contain(const Channel::Ptr& channel) const noexcept override {
-    return channels_.count(channel->GetFile().Descriptor());
+    int fd = channel->GetFile().Descriptor();
+    return fd >= 0 && (size_t)fd < slots_.size() && slots_[fd].channel;
   }
 
   Error Wait(Duration timeout) override {
-    if (cleanable_) {
-      CleanUp();
-    }
+    released_.clear();
+    ready_.clear();
 
-    ready_ = 0;
+    int64_t usec = std::max<int64_t>(timeout.Microseconds(), 0);
+    struct timespec ts {};
+    ts.tv_sec = usec / Duration::kMicroseconds;
+    ts.tv_nsec = (usec % Duration::kMicroseconds) * 1000;
 
-    int n = poll(buf_.data(), buf_.size(), (int)timeout.Milliseconds());
+    int n = ::ppoll(buf_.data(), buf_.size(), &ts, nullptr);
     if (n < 0) {
       return Error{errno};
     }
 
-    ready_ = n;
-    std::partition(buf_.begin(), buf_.end(),
-                   [](const struct pollfd& p) { return p.revents != 0; });
+    for (size_t i = 0; i < buf_.size() && ready_.size() < (size_t)n; ++i) {
+      auto& p = buf_[i];
+      if (p.revents == 0) {
+        continue;
+      }
+      auto& ready = ready_.emplace_back();
+      ready.fd = p.fd;
+      ready.generation = slots_[p.fd].generation;
+      ready.events = ReceiveEvents{(uint16_t)p.revents};
+    }
 
     return Error::Success();
   }
 
-  [[nodiscard]] size_t Size() const override { return ready_; }
+  [[nodiscard]] size_t Size() const override { return ready_.size(); }
 
   [[nodiscard]] SelectChannel Get(size_t index) const override {
-    auto& p = buf_[index];
-    auto it = channels_.find(p.fd);
-    if (it == channels_.end()) {
+    auto& ready = ready_[index];
+    auto& slot = slots_[ready.fd];
+    if (slot.generation != ready.generation || !slot.channel) {
       return {nullptr, ReceiveEvents{0}};
     }
-    return {it->second.second, ReceiveEvents{(uint32_t)p.revents}};
+    return {slot.channel.get(), ready.events};
   }
 };
 }  // namespace pedronet
@@ -13,7 +13,9 @@
 
 namespace pedronet {
 
-using SelectChannel = std::pair<Channel::Ptr, ReceiveEvents>;
+// The channel stays alive until the next Wait(), even if it is removed while
+// the events are being dispatched.
+using SelectChannel = std::pair<Channel*, ReceiveEvents>;
 
 struct Selector : pedrolib::noncopyable, pedrolib::nonmovable {
   virtual void Add(const Channel::Ptr& channel, SelectEvents events) = 0;
@@ -21,10 +23,35 @@ struct Selector : pedrolib::noncopyable, pedrolib::nonmovable {
   virtual void Update(Channel* channel, SelectEvents events) = 0;
   [[nodiscard]] virtual bool Contain(const Channel::Ptr& channel) const noexcept = 0;
   
+  // Update() only records the interest of a channel, the changes since the
+  // last call are applied here, once per channel with its final interest.
+  // EventLoop calls it right before Wait().
+  virtual void Flush() {}
+
+  // Number of interest changes handed to the kernel, e.g. epoll_ctl(2) calls.
+  [[nodiscard]] virtual uint64_t Updates() const noexcept { return 0; }
+
   virtual Error Wait(Duration timeout) = 0;
   [[nodiscard]] virtual size_t Size() const = 0;
   [[nodiscard]] virtual SelectChannel Get(size_t index) const = 0;
-  
+
+  // Completion-based operations for the added channels. Their results are
+  // selected with ReceiveEvents::kCompletion, and should be dispatched to
+  // Channel::HandleCompletion. Return false if the selector does not support
+  // them, the caller should wait for the readiness instead.
+  virtual bool Accept(Channel* channel) { return false; }
+  virtual bool Receive(Channel* channel) { return false; }
+
+  [[nodiscard]] virtual bool Supports(SelectTrigger trigger) const noexcept {
+    return trigger == SelectTrigger::kLevel;
+  }
+
+  [[nodiscard]] virtual const SelectCompletion& GetCompletion(
+      size_t index) const {
+    static const SelectCompletion kNoneCompletion{};
+    return kNoneCompletion;
+  }
+
   virtual ~Selector() = default;
 };
 }  // namespace pedronet
@@ -3,6 +3,7 @@
 
 #include "pedronet/logger/logger.h"
 #include "pedronet/selector/epoller.h"
+#include "pedronet/selector/io_uring_selector.h"
 #include "pedronet/selector/poller.h"
 #include "pedronet/options.h"
 
@@ -14,6 +15,12 @@ inline static std::unique_ptr<Selector> MakeSelector(SelectorType type) {
       return std::make_unique<EpollSelector>();
     case SelectorType::kPoll:
       return std::make_unique<Poller>();
+    case SelectorType::kIoUring:
+      if (IoUringSelector::Supported()) {
+        return std::make_unique<IoUringSelector>();
+      }
+      PEDRONET_WARN("io_uring is not supported, fallback to epoll");
+      return std::make_unique<EpollSelector>();
     default:
       return nullptr;
   }
@@ -7,6 +7,7 @@
 namespace pedronet {
 
 class Socket : public File {
+  friend class Acceptor;
   explicit Socket(int fd) : File(fd) {}
 
  public:
@@ -27,6 +28,7 @@ class Socket : public File {
   void SetReusePort(bool on);
   void SetKeepAlive(bool on);
   void SetTcpNoDelay(bool on);
+  void SetBusyPoll(Duration timeout);
 
   [[nodiscard]] InetAddress GetLocalAddress() const;
   [[nodiscard]] InetAddress GetPeerAddress() const;
@@ -0,0 +1,166 @@
+#ifndef PEDRONET_TASK_H
+#define PEDRONET_TASK_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+namespace pedronet {
+
+// A move-only void() callable for the event and timer queues. Callables of up
+// to kInlineSize bytes, e.g. a lambda capturing a shared_ptr and a
+// std::string, are stored in place instead of on the heap.
+class Task {
+ public:
+  static constexpr size_t kInlineSize = 64;
+
+  Task() noexcept = default;
+
+  Task(std::nullptr_t) noexcept {}  // NOLINT
+
+  template <typename F, typename D = std::decay_t<F>,
+            typename = std::enable_if_t<!std::is_same_v<D, Task> &&
+                                        std::is_invocable_v<D&>>>
+  Task(F&& f) {  // NOLINT
+    if constexpr (std::is_same_v<D, std::function<void()>>) {
+      if (!f) {
+        return;
+      }
+    }
+
+    if constexpr (kInline<D>) {
+      ::new (storage_) D(std::forward<F>(f));
+    } else {
+      ::new (storage_) D*(new D(std::forward<F>(f)));
+    }
+    ops_ = &kOps<D>;
+  }
+
+  Task(Task&& other) noexcept : ops_(other.ops_) {
+    if (ops_ != nullptr) {
+      ops_->move(storage_, other.storage_);
+      other.ops_ = nullptr;
+    }
+  }
+
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      reset();
+      if (other.ops_ != nullptr) {
+        other.ops_->move(storage_, other.storage_);
+        ops_ = std::exchange(other.ops_, nullptr);
+      }
+    }
+    return *this;
+  }
+
+  Task& operator=(std::nullptr_t) noexcept {
+    reset();
+    return *this;
+  }
+
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+
+  ~Task() { reset(); }
+
+  explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+  // Like std::function, a const task may still change its callable.
+  void operator()() const {
+#ifdef PEDRONET_WATCHDOG
+    if (auto* running = Running(); running != nullptr) {
+      const std::type_info* outer = running->load(std::memory_order_relaxed);
+      running->store(ops_->type, std::memory_order_relaxed);
+      ops_->invoke(storage_);
+      running->store(outer, std::memory_order_relaxed);
+      return;
+    }
+#endif
+    ops_->invoke(storage_);
+  }
+
+  // The type of the callable, the task must not be empty.
+  [[nodiscard]] const std::type_info& Type() const noexcept {
+    return *ops_->type;
+  }
+
+#ifdef PEDRONET_WATCHDOG
+  // Set by an EventLoop on its thread, the type of the task being run there
+  // is published to it for the watchdog.
+  static std::atomic<const std::type_info*>*& Running() noexcept {
+    thread_local std::atomic<const std::type_info*>* running = nullptr;
+    return running;
+  }
+#endif
+
+ private:
+  struct Ops {
+    void (*invoke)(void* storage);
+    void (*move)(void* dst, void* src) noexcept;
+    void (*destroy)(void* storage) noexcept;
+    const std::type_info* type;
+  };
+
+  template <typename D>
+  static constexpr bool kInline =
+      sizeof(D) <= kInlineSize &&
+      alignof(D) <= alignof(std::max_align_t) &&
+      std::is_nothrow_move_constructible_v<D>;
+
+  template <typename D>
+  static D* get(void* storage) noexcept {
+    if constexpr (kInline<D>) {
+      return std::launder(reinterpret_cast<D*>(storage));
+    } else {
+      return *std::launder(reinterpret_cast<D**>(storage));
+    }
+  }
+
+  template <typename D>
+  static void invoke(void* storage) {
+    (*get<D>(storage))();
+  }
+
+  template <typename D>
+  static void move(void* dst, void* src) noexcept {
+    if constexpr (kInline<D>) {
+      D* f = get<D>(src);
+      ::new (dst) D(std::move(*f));
+      f->~D();
+    } else {
+      ::new (dst) D*(get<D>(src));
+    }
+  }
+
+  template <typename D>
+  static void destroy(void* storage) noexcept {
+    if constexpr (kInline<D>) {
+      get<D>(storage)->~D();
+    } else {
+      delete get<D>(storage);
+    }
+  }
+
+  template <typename D>
+  inline static constexpr Ops kOps{&invoke<D>, &move<D>, &destroy<D>,
+                                   &typeid(D)};
+
+  void reset() noexcept {
+    if (ops_ != nullptr) {
+      ops_->destroy(storage_);
+      ops_ = nullptr;
+    }
+  }
+
+  alignas(std::max_align_t) mutable unsigned char storage_[kInlineSize];
+  const Ops* ops_{};
+};
+
+}  // namespace pedronet
+
+#endif  // PEDRONET_TASK_H
@@ -13,8 +13,10 @@
 #include "pedronet/socket.h"
 
 #include <any>
+#include <atomic>
 #include <memory>
 #include <utility>
+#include <vector>
 
 namespace pedronet {
 
@@ -26,6 +28,7 @@ class ChannelContext {
 
   TcpConnection* GetConnection() { return conn_; }
   ArrayBuffer* GetOutputBuffer();
+  // The buffer passed to the running ChannelHandler::OnRead(), if any.
   ArrayBuffer* GetInputBuffer();
 
  private:
@@ -36,6 +39,8 @@ struct ChannelHandler {
   using Ptr = std::shared_ptr<ChannelHandler>;
 
   virtual ~ChannelHandler() = default;
+  // The buffer holds the received bytes not consumed yet, it may be another
+  // object on every call and must not be kept past the call.
   virtual void OnRead(Timestamp now, ArrayBuffer& buffer) = 0;
   virtual void OnWriteComplete(Timestamp now) = 0;
   virtual void OnError(Timestamp now, Error err) = 0;
@@ -76,17 +81,45 @@ class TcpConnection final : pedrolib::noncopyable,
 
   ArrayBuffer output_;
   ArrayBuffer input_;
+  // The buffer handed to OnRead(), input_ unless a received completion is
+  // dispatched from the scratch buffer, see handleReceive().
+  ArrayBuffer* reading_{&input_};
 
   SocketChannel::Ptr channel_;
   ChannelHandler::Ptr handler_;
   ChannelContext::Ptr context_;
 
   InetAddress local_;
-  EventLoop& eventloop_;
+  std::atomic<EventLoop*> eventloop_;
+  SelectTrigger trigger_{SelectTrigger::kLevel};
+  // A multishot receive is armed in the selector, see SubmitReceive(). Read
+  // by Migrate() from other threads.
+  std::atomic_bool receiving_{};
 
   Latch close_latch_;
 
+  // Bytes read and written since the last TakeTraffic().
+  std::atomic_uint64_t traffic_{};
+
+  // Tasks scheduled onto the loop and not run yet. While migrating, new ones
+  // are deferred until the connection is registered on the target loop.
+  SpinLock mu_;
+  std::atomic_bool migrating_{};
+  std::atomic_size_t inflight_{};
+  std::vector<Task> deferred_;
+
+  [[nodiscard]] bool internalOwned() const noexcept {
+    return EventLoop::GetEventLoop() == eventloop_.load() && !migrating_;
+  }
+
+  // Runs the task on the loop owning the connection, tasks of a thread run in
+  // the order they were passed in even across a migration.
+  void internalRun(Task task);
+  void internalMigrate(EventLoop& target);
+  void internalResume();
+
   void handleRead(Timestamp now);
+  void handleReceive(const SelectCompletion& completion, Timestamp now);
   void handleError(Error);
   void handleWrite();
   void handleClose();
@@ -115,6 +148,9 @@ class TcpConnection final : pedrolib::noncopyable,
     handler_ = std::move(handler);
   }
 
+  // Takes effect in Start().
+  void SetTrigger(SelectTrigger trigger) noexcept { trigger_ = trigger; }
+
   const InetAddress& GetLocalAddress() const noexcept { return local_; }
 
   InetAddress GetPeerAddress() const noexcept {
@@ -126,7 +162,15 @@ class TcpConnection final : pedrolib::noncopyable,
   void ForceShutdown();
   void ForceClose();
 
-  EventLoop& GetEventLoop() noexcept { return eventloop_; }
+  // Moves the connection with its buffers and handler onto the target loop.
+  // Pending output and tasks are carried over and nothing received is lost.
+  // Returns false if the connection is not connected, is already migrating,
+  // or is served by a completion based selector.
+  bool Migrate(EventLoop& target);
+
+  [[nodiscard]] uint64_t TakeTraffic() noexcept { return traffic_.exchange(0); }
+
+  EventLoop& GetEventLoop() noexcept { return *eventloop_; }
 
   std::string String() const;
   void handleSend(std::string_view buffer);
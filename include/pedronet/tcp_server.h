@@ -31,6 +31,9 @@ class TcpServer : pedrolib::noncopyable, pedrolib::nonmovable {
   std::unordered_set<TcpConnection::Ptr> conns_;
 
   TcpServerOptions options_{};
+  uint64_t rebalance_timer_{};
+
+  void internalRebalance();
 
  public:
   TcpServer() = default;
@@ -0,0 +1,68 @@
+#ifndef PEDRONET_WATCHDOG_H
+#define PEDRONET_WATCHDOG_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <typeinfo>
+#include <vector>
+
+#include "pedronet/options.h"
+
+namespace pedronet {
+
+class EventLoop;
+
+// What a loop is doing, written by the loop with relaxed stores only and
+// read by the watchdog.
+struct LoopActivity {
+  enum class Stage { kWait, kDispatch, kDrain, kTimers };
+
+  // Steady clock nanoseconds of the last return from Selector::Wait().
+  std::atomic_uint64_t busy_since{};
+  std::atomic<Stage> stage{Stage::kWait};
+
+  // The channel being dispatched to.
+  std::atomic<const std::type_info*> channel{};
+  std::atomic_int fd{-1};
+
+  // The callable type of the innermost task being run, see Task::Running().
+  std::atomic<const std::type_info*> task{};
+};
+
+// Polls the activities of the loops of an EventLoopGroup and reports every
+// loop stuck in one iteration for longer than the threshold.
+class Watchdog {
+ public:
+  Watchdog(std::vector<EventLoop*> loops, const EventLoopOptions& options);
+
+  ~Watchdog() {
+    Stop();
+    Join();
+  }
+
+  void Stop();
+  void Join();
+
+ private:
+  void internalRun();
+  void internalCheck(size_t index, uint64_t now);
+
+  std::vector<EventLoop*> loops_;
+  Duration threshold_;
+  std::function<void(const StallReport&)> callback_;
+
+  // The busy_since of the stall reported last, per loop.
+  std::vector<uint64_t> reported_;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool stopped_{};
+  std::thread thread_;
+};
+
+}  // namespace pedronet
+
+#endif  // PEDRONET_WATCHDOG_H
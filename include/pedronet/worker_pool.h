@@ -0,0 +1,164 @@
+#ifndef PEDRONET_WORKER_POOL_H
+#define PEDRONET_WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pedronet/eventloop.h"
+#include "pedronet/eventloopgroup.h"
+#include "pedronet/logger/logger.h"
+#include "pedronet/task.h"
+
+namespace pedronet {
+
+// A work-stealing thread pool for blocking or CPU-heavy work which must not
+// run on an EventLoop. Every worker has its own deque: it pops its newest
+// task and steals the oldest task of another worker when its own is empty.
+//
+// Submit() runs the continuation back on the loop that submitted the work.
+// Continuations are collected per loop, and a loop gets one task draining
+// all of them no matter how many complete in the meantime. Continuations for
+// a loop which is closed by then are dropped with a warning.
+//
+// Schedule() and Submit() are fatal once the pool is closed, except on the
+// workers themselves.
+class WorkerPool : public Executor {
+  struct Worker {
+    alignas(64) SpinLock mu;
+    std::deque<Task> tasks;
+  };
+
+  // Continuations waiting to run on a loop, replaced once the loop closes.
+  struct Completions : std::enable_shared_from_this<Completions> {
+    explicit Completions(std::shared_ptr<EventLoop::Handle> loop)
+        : loop(std::move(loop)) {}
+
+    void Add(Task task);
+    void Drain();
+
+    std::shared_ptr<EventLoop::Handle> loop;
+    SpinLock mu;
+    std::vector<Task> tasks;
+    // Owned by the loop.
+    std::vector<Task> running;
+  };
+
+  struct Current {
+    WorkerPool* pool{};
+    size_t index{};
+  };
+
+  static Current& current() noexcept;
+
+  std::shared_ptr<Completions> internalCompletions(EventLoop& loop);
+  bool internalPush(Task task);
+  void internalSchedule(Task task);
+  bool internalPop(size_t index, Task& task);
+  bool internalSteal(size_t index, Task& task);
+  bool internalNext(size_t index, Task& task);
+  void internalRun(size_t index);
+  void HandleJoin();
+
+ public:
+  using Ptr = std::shared_ptr<WorkerPool>;
+
+  explicit WorkerPool(size_t threads);
+
+  static WorkerPool::Ptr Create() {
+    return Create(std::thread::hardware_concurrency());
+  }
+
+  static WorkerPool::Ptr Create(size_t threads);
+
+  ~WorkerPool() override {
+    Close();
+    HandleJoin();
+  }
+
+  // The number of tasks waiting for a worker.
+  [[nodiscard]] size_t Size() const noexcept override {
+    return pending_.load(std::memory_order_relaxed);
+  }
+
+  void Schedule(Callback cb) override {
+    internalSchedule(Task{std::move(cb)});
+  }
+
+  template <typename Runnable>
+  void Schedule(Runnable&& runnable) {
+    internalSchedule(Task{std::forward<Runnable>(runnable)});
+  }
+
+  // Runs work on the pool, then then(result) on the target loop, or then()
+  // if work returns void.
+  template <typename Work, typename Then>
+  void Submit(EventLoop& target, Work&& work, Then&& then) {
+    internalSchedule(Task{[completions = internalCompletions(target),
+                       work = std::forward<Work>(work),
+                       then = std::forward<Then>(then)]() mutable {
+      if constexpr (std::is_void_v<std::invoke_result_t<Work&>>) {
+        work();
+        completions->Add(Task{std::move(then)});
+      } else {
+        completions->Add(
+            Task{[then = std::move(then), result = work()]() mutable {
+              then(std::move(result));
+            }});
+      }
+    }});
+  }
+
+  // Must be called on an EventLoop, the continuation runs on it.
+  template <typename Work, typename Then>
+  void Submit(Work&& work, Then&& then) {
+    EventLoop* loop = EventLoop::GetEventLoop();
+    if (loop == nullptr) {
+      PEDRONET_FATAL("WorkerPool::Submit() is not called on an EventLoop");
+    }
+    Submit(*loop, std::forward<Work>(work), std::forward<Then>(then));
+  }
+
+  // Timers are kept by a loop of the pool, the callbacks run on the workers.
+  uint64_t ScheduleAfter(Duration delay, Callback cb) override;
+
+  uint64_t ScheduleEvery(Duration delay, Duration interval,
+                         Callback cb) override;
+
+  void ScheduleCancel(uint64_t id) override;
+
+  // Queued tasks still run before the workers exit.
+  void Close() override;
+
+  void Join() override;
+
+ private:
+  inline static std::atomic_uint64_t counter_{};
+
+  const uint64_t id_{counter_.fetch_add(1) + 1};
+  std::vector<Worker> workers_;
+  std::vector<std::thread> threads_;
+  std::atomic_size_t next_{};
+  EventLoopGroup::Ptr timer_group_;
+
+  SpinLock completions_mu_;
+  std::unordered_map<EventLoop*, std::shared_ptr<Completions>> completions_;
+
+  // Tasks in the deques, and workers waiting for one.
+  alignas(64) std::atomic_size_t pending_{};
+  std::atomic_size_t sleepers_{};
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::atomic_bool closed_{};
+};
+
+}  // namespace pedronet
+
+#endif  // PEDRONET_WORKER_POOL_H
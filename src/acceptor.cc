@@ -33,6 +33,18 @@ Acceptor::Acceptor(EventLoop& eventloop, const InetAddress& address,
       }
     }
   });
+
+  channel_->OnComplete([this](const SelectCompletion& completion, auto now) {
+    PEDRONET_TRACE("{}::handleComplete()", *this);
+    if (completion.result < 0) {
+      PEDRONET_ERROR("failed to accept [{}]", Error{-completion.result});
+      return;
+    }
+    Socket socket{completion.result};
+    if (acceptor_callback_) {
+      acceptor_callback_(std::move(socket));
+    }
+  });
 }
 
 std::string Acceptor::String() const {
@@ -49,8 +61,10 @@ void Acceptor::Close() {
 
 void Acceptor::Listen() {
   eventloop_.Add(channel_, [this] {
-    channel_->SetReadable(true);
     channel_->Listen();
+    if (!channel_->SubmitAccept()) {
+      channel_->SetReadable(true);
+    }
   });
 }
 }  // namespace pedronet
\ No newline at end of file
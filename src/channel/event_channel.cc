@@ -30,6 +30,12 @@ std::string EventChannel::String() const {
 }
 
 void EventChannel::WakeUp() {
+  // Pairs with the event queue check of the loop after SetSleeping(true):
+  // either the loop sees the new event, or the producer sees it sleeping.
+  if (!sleeping_.load()) {
+    return;
+  }
+
   uint64_t val = 1;
   file_.Write(&val, sizeof(val));
 }
@@ -4,6 +4,31 @@
 
 namespace pedronet {
 
+SelectEvents SocketChannel::internalInterest(SelectEvents events) const {
+  if (trigger_ == SelectTrigger::kLevel || events.Value() == 0) {
+    return events;
+  }
+  // An edge-triggered channel keeps waiting for writability, toggling the
+  // write interest would cost a selector update on every partial write.
+  return events.Add(SelectEvents::kWriteEvent).Trigger(trigger_);
+}
+
+void SocketChannel::internalUpdate(SelectEvents events) {
+  SelectEvents interest = internalInterest(events_);
+  if (internalInterest(events) != interest) {
+    selector_->Update(this, interest);
+  }
+}
+
+void SocketChannel::SetTrigger(SelectTrigger trigger) {
+  if (!selector_->Supports(trigger)) {
+    PEDRONET_TRACE("{} does not support the trigger, fallback to level",
+                   *this);
+    trigger = SelectTrigger::kLevel;
+  }
+  trigger_ = trigger;
+}
+
 void SocketChannel::SetWritable(bool on) {
   auto ev = events_;
   if (on) {
@@ -12,7 +37,7 @@ void SocketChannel::SetWritable(bool on) {
     events_.Remove(SelectEvents::kWriteEvent);
   }
   if (ev != events_) {
-    selector_->Update(this, events_);
+    internalUpdate(ev);
   }
 }
 
@@ -24,7 +49,28 @@ void SocketChannel::SetReadable(bool on) {
     events_.Remove(SelectEvents::kReadEvent);
   }
   if (ev != events_) {
-    selector_->Update(this, events_);
+    internalUpdate(ev);
+  }
+}
+
+void SocketChannel::Rearm() {
+  if (events_.Value() != 0) {
+    selector_->Update(this, internalInterest(events_));
+  }
+}
+
+bool SocketChannel::SubmitAccept() {
+  return selector_->Accept(this);
+}
+
+bool SocketChannel::SubmitReceive() {
+  return selector_->Receive(this);
+}
+
+void SocketChannel::HandleCompletion(const SelectCompletion& completion,
+                                     Timestamp now) {
+  if (completion_callback_) {
+    completion_callback_(completion, now);
   }
 }
 
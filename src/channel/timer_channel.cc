@@ -27,6 +27,32 @@ void TimerChannel::HandleEvents(ReceiveEvents, Timestamp) {
   }
 }
 
+void TimerChannel::WakeUpAt(Timestamp timestamp) {
+  if (!deadline_callback_) {
+    WakeUpAfter(timestamp - Timestamp::Now());
+    return;
+  }
+
+  int64_t us = deadline_us_.load();
+  while (timestamp.usecs < us) {
+    if (deadline_us_.compare_exchange_weak(us, timestamp.usecs)) {
+      deadline_callback_();
+      return;
+    }
+  }
+}
+
+bool TimerChannel::Expire(Timestamp now) {
+  int64_t us = deadline_us_.load();
+  while (us <= now.usecs) {
+    if (deadline_us_.compare_exchange_weak(
+            us, std::numeric_limits<int64_t>::max())) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void TimerChannel::WakeUpAfter(Duration duration) {
   duration = std::max(duration, kMinWakeUpDuration);
 
@@ -22,4 +22,7 @@ const ReceiveEvents ReceiveEvents::kReadable{POLLIN};
 const ReceiveEvents ReceiveEvents::kPriorReadable{POLLPRI};
 const ReceiveEvents ReceiveEvents::kReadHangUp{POLLRDHUP};
 const ReceiveEvents ReceiveEvents::kWritable{POLLOUT};
+
+// Not a poll(2) event, it marks the results of completion-based operations.
+const ReceiveEvents ReceiveEvents::kCompletion{1u << 30};
 }  // namespace pedronet
\ No newline at end of file
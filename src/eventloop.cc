@@ -1,6 +1,10 @@
 #include "pedronet/eventloop.h"
 #include "pedronet/logger/logger.h"
 
+#include <algorithm>
+#include <limits>
+#include <utility>
+
 namespace pedronet {
 
 void EventLoop::Loop() {
@@ -18,9 +22,33 @@ void EventLoop::Loop() {
   PEDRONET_TRACE("EventLoop::Loop() running");
 
   current() = this;
+#ifdef PEDRONET_WATCHDOG
+  Task::Running() = &activity_.task;
+#endif
 
   while (state_ & kLooping) {
-    Error err = selector_->Wait(options_.select_timeout);
+    selector_->Flush();
+
+    Duration timeout = internalTimeout();
+    if (timeout > Duration::Zero()) {
+      event_channel_->SetSleeping(true);
+      // A deadline moved earlier by another thread in between found the loop
+      // awake and skipped the wakeup, so it is read again.
+      if (internalPending()) {
+        timeout = Duration::Zero();
+      } else {
+        timeout = internalTimeout();
+      }
+    }
+#ifdef PEDRONET_METRICS
+    uint64_t wait_start = LoopMetrics::Now();
+#endif
+    internalActivity(LoopActivity::Stage::kWait);
+    Error err = selector_->Wait(timeout);
+    event_channel_->SetSleeping(false);
+#ifdef PEDRONET_WATCHDOG
+    activity_.busy_since.store(LoopMetrics::Now(), std::memory_order_relaxed);
+#endif
     if (err != Error::kOk) {
       PEDRONET_ERROR("failed to call selector_.Wait(): {}", err);
       continue;
@@ -28,24 +56,180 @@ void EventLoop::Loop() {
     Timestamp now = Timestamp::Now();
 
     size_t n = selector_->Size();
+#ifdef PEDRONET_METRICS
+    uint64_t dispatch_start = LoopMetrics::Now();
+    metrics_.wait_ns.Record(dispatch_start - wait_start);
+    metrics_.ready.Record(n);
+#endif
     for (size_t i = 0; i < n; ++i) {
       auto [ch, ev] = selector_->Get(i);
       if (ch == nullptr) {
         continue;
       }
+      internalActivity(LoopActivity::Stage::kDispatch, ch);
+      if (ev.Contains(ReceiveEvents::kCompletion)) {
+        ch->HandleCompletion(selector_->GetCompletion(i), now);
+        continue;
+      }
       ch->HandleEvents(ev, now);
     }
+#ifdef PEDRONET_METRICS
+    // The event channel drains the queue from within the dispatch.
+    uint64_t dispatch_ns = LoopMetrics::Now() - dispatch_start;
+    metrics_.dispatch_ns.Record(dispatch_ns - drain_ns_);
+#endif
+
+    // Tasks scheduled while the loop was awake came without a wakeup, and
+    // the budgets may have left some behind.
+    internalActivity(LoopActivity::Stage::kDrain);
+    if (internalPending()) {
+      internalDrain(false);
+      n++;
+    }
+#ifdef PEDRONET_METRICS
+    metrics_.drain_ns.Record(std::exchange(drain_ns_, 0));
+    metrics_.tasks.Record(std::exchange(drained_, 0));
+#endif
+
+    if (options_.select_timer && timer_channel_->Expire(Timestamp::Now())) {
+      internalActivity(LoopActivity::Stage::kTimers);
+      timer_queue_->Process();
+    }
+
+    if (options_.busy_poll > Duration::Zero()) {
+      internalBusyPoll(n, now);
+    }
   }
   
+#ifdef PEDRONET_WATCHDOG
+  Task::Running() = nullptr;
+#endif
   current() = nullptr;
 }
 
-void EventLoop::Close() {
-  state_.fetch_and(~kLooping);
+Duration EventLoop::internalTimeout() const {
+  if (spinning_) {
+    return Duration::Zero();
+  }
 
+  Duration timeout = options_.select_timeout;
+  if (options_.select_timer) {
+    int64_t us = timer_channel_->GetDeadline() - Timestamp::Now().usecs;
+    us = std::max<int64_t>(us, 0);
+    timeout = std::min(timeout, Duration::Microseconds(us));
+  }
+  return timeout;
+}
+
+void EventLoop::internalBusyPoll(size_t events, Timestamp now) {
+  Duration max = options_.busy_poll;
+  if (events != 0) {
+    if (spinning_) {
+      spin_budget_ = std::min(spin_budget_ + spin_budget_, max);
+    }
+    spinning_ = true;
+    spin_deadline_ = now + spin_budget_;
+    return;
+  }
+
+  if (spinning_ && now >= spin_deadline_) {
+    Duration min = Duration::Microseconds(max.Microseconds() / 16);
+    spin_budget_ = Duration::Microseconds(spin_budget_.Microseconds() / 2);
+    spin_budget_ = std::max(spin_budget_, min);
+    spinning_ = false;
+  }
+}
+
+size_t EventLoop::GetQueueDepth() const {
+  size_t depth = 0;
+  for (auto& queue : event_queues_) {
+    depth += queue->Size();
+  }
+  return depth;
+}
+
+bool EventLoop::internalPending() const {
+  for (auto& queue : event_queues_) {
+    if (!queue->Empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void EventLoop::internalDrain(bool urgent_only) {
+#ifdef PEDRONET_METRICS
+  uint64_t start = LoopMetrics::Now();
+#endif
+  size_t n = internalDrainUrgent();
+  if (!urgent_only) {
+    n += internalDrain(TaskPriority::kNormal, options_.normal_budget);
+    n += internalDrain(TaskPriority::kBackground, options_.background_budget);
+  }
+#ifdef PEDRONET_METRICS
+  drained_ += n;
+  drain_ns_ += LoopMetrics::Now() - start;
+#endif
+}
+
+size_t EventLoop::internalDrain(TaskPriority priority,
+                                const TaskBudget& budget) {
+  bool timed = budget.time > Duration::Zero();
+  size_t max = budget.tasks;
+  if (max == 0) {
+    max = std::numeric_limits<size_t>::max();
+  }
+
+  // A budgeted class runs in chunks, the clock is checked and the urgent
+  // tasks they schedule are run in between.
+  constexpr size_t kChunk = 16;
+  size_t chunk = max;
+  if (budget.tasks != 0 || timed) {
+    chunk = kChunk;
+  }
+
+  Timestamp deadline;
+  if (timed) {
+    deadline = Timestamp::Now() + budget.time;
+  }
+
+  EventQueue* queue = internalQueue(priority);
+  size_t n = 0;
+  size_t urgent = 0;
+  while (n < max) {
+    size_t k = queue->Process(std::min(max - n, chunk));
+    n += k;
+    urgent += internalDrainUrgent();
+    if (k < chunk || (timed && Timestamp::Now() >= deadline)) {
+      break;
+    }
+  }
+  return n + urgent;
+}
+
+size_t EventLoop::internalDrainUrgent() {
+  EventQueue* queue = internalQueue(TaskPriority::kUrgent);
+  return queue->Empty() ? 0 : queue->Process();
+}
+
+LoopMetrics::Snapshot EventLoop::GetMetrics() const noexcept {
+#ifdef PEDRONET_METRICS
+  return metrics_.Get();
+#else
+  return {};
+#endif
+}
+
+void EventLoop::Close() {
   PEDRONET_TRACE("EventLoop is shutting down.");
 
+  // The tasks scheduled through the handle before are ahead of the one below.
+  handle_->Close();
+
+  // Stop looping from the loop itself, so the task is not left behind in the
+  // queue when the loop is awake and exits before draining it.
   Schedule([this] {
+    state_.fetch_and(~kLooping);
     selector_->Remove(event_channel_);
     selector_->Remove(timer_channel_);
     close_latch_.CountDown();
@@ -55,7 +239,7 @@ void EventLoop::Close() {
 }
 
 void EventLoop::Schedule(Callback cb) {
-  event_queue_->Add(std::move(cb));
+  internalQueue(TaskPriority::kNormal)->Add(std::move(cb));
 }
 
 void EventLoop::Add(const Channel::Ptr& channel, Callback callback) {
@@ -97,16 +281,34 @@ EventLoop::EventLoop(const EventLoopOptions& options)
       selector_(MakeSelector(options.selector_type)),
       event_channel_(std::make_shared<EventChannel>()),
       timer_channel_(std::make_shared<TimerChannel>()),
-      event_queue_(
-          MakeEventQueue(options.event_queue_type, event_channel_.get())),
       timer_queue_(
-          MakeTimerQueue(options.timer_queue_type, timer_channel_.get())) {
+          MakeTimerQueue(options.timer_queue_type, timer_channel_.get())),
+      spin_budget_(options.busy_poll) {
+  for (auto& queue : event_queues_) {
+    queue = MakeEventQueue(options.event_queue_type, event_channel_.get());
+  }
 
   selector_->Add(event_channel_, SelectEvents::kReadEvent);
-  selector_->Add(timer_channel_, SelectEvents::kReadEvent);
+  // The other tasks wait for the I/O of the iteration.
+  event_channel_->SetEventCallBack(
+      [this] { internalDrain(true); });
+#ifdef PEDRONET_METRICS
+  timer_queue_->SetLagHistogram(&metrics_.timer_lag_us);
+#endif
 
-  event_channel_->SetEventCallBack([this] { event_queue_->Process(); });
-  timer_channel_->SetEventCallBack([this] { timer_queue_->Process(); });
+  if (options.select_timer) {
+    // Timers added by other threads may have to cut the current Wait() short.
+    timer_channel_->SetDeadlineCallback([this] {
+      if (current() != this) {
+        event_channel_->WakeUp();
+      }
+    });
+    // The timer queue publishes its next deadline when it is processed.
+    timer_channel_->WakeUpAt(Timestamp::Now());
+  } else {
+    selector_->Add(timer_channel_, SelectEvents::kReadEvent);
+    timer_channel_->SetEventCallBack([this] { timer_queue_->Process(); });
+  }
 
   PEDRONET_TRACE("create event loop");
 }
@@ -1,38 +1,142 @@
 #include "pedronet/eventloopgroup.h"
+#include "pedronet/logger/logger.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <limits>
+#include <random>
 
 namespace pedronet {
 
+static void SetAffinity(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  int err = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+  if (err != 0) {
+    PEDRONET_WARN("failed to pin event loop to cpu {}: {}", cpu, err);
+  }
+}
+
+EventLoopGroup::Ptr EventLoopGroup::Create(size_t threads,
+                                           const EventLoopOptions& options) {
+  auto group = std::make_shared<EventLoopGroup>(threads);
+
+  // Every thread pins itself before constructing its loop, so the loop, its
+  // selector and its queues are first touched on the memory node of its CPU.
+  Latch latch(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    auto& loop = group->loops_[i];
+    group->threads_.emplace_back([&, i] {
+      if (!options.cpus.empty()) {
+        SetAffinity(options.cpus[i % options.cpus.size()]);
+      }
+      loop = std::make_unique<EventLoop>(options);
+      EventLoop* self = loop.get();
+      latch.CountDown();
+      self->Loop();
+    });
+  }
+  latch.Await();
+
+  if (options.stall_threshold > Duration::Zero()) {
+#ifdef PEDRONET_WATCHDOG
+    std::vector<EventLoop*> loops;
+    for (auto& loop : group->loops_) {
+      loops.emplace_back(loop.get());
+    }
+    group->watchdog_ = std::make_unique<Watchdog>(std::move(loops), options);
+#else
+    PEDRONET_WARN("stall_threshold needs PEDRONET_WATCHDOG, ignored");
+#endif
+  }
+  return group;
+}
+
 size_t EventLoopGroup::next() noexcept {
   return next_.fetch_add(1, std::memory_order_relaxed) % size_;
 }
 
+// Scans from a rotating start, so ties don't always go to the first loop.
+template <typename Load>
+static EventLoop& LeastLoaded(std::vector<std::unique_ptr<EventLoop>>& loops,
+                              size_t first, Load&& load) {
+  EventLoop* best = nullptr;
+  size_t min = std::numeric_limits<size_t>::max();
+  for (size_t i = 0; i < loops.size(); ++i) {
+    EventLoop& loop = *loops[(first + i) % loops.size()];
+    size_t n = load(loop);
+    if (best == nullptr || n < min) {
+      best = &loop;
+      min = n;
+    }
+  }
+  return *best;
+}
+
+EventLoop& EventLoopGroup::Next(PlacementPolicy policy) {
+  switch (policy) {
+    case PlacementPolicy::kLeastConnections:
+      return LeastLoaded(loops_, next(),
+                         [](EventLoop& loop) { return loop.GetConnections(); });
+    case PlacementPolicy::kLeastQueueDepth:
+      return LeastLoaded(loops_, next(),
+                         [](EventLoop& loop) { return loop.GetQueueDepth(); });
+    case PlacementPolicy::kPowerOfTwoChoices: {
+      thread_local std::minstd_rand rng{std::random_device{}()};
+      // The second choice is drawn from the other loops.
+      size_t i = rng() % size_;
+      size_t j = size_ > 1 ? (i + 1 + rng() % (size_ - 1)) % size_ : i;
+      EventLoop& a = *loops_[i];
+      EventLoop& b = *loops_[j];
+      return b.GetConnections() < a.GetConnections() ? b : a;
+    }
+    default:
+      return Next();
+  }
+}
+
 void EventLoopGroup::Join() {
   HandleJoin();
 }
 
 uint64_t EventLoopGroup::ScheduleAfter(Duration delay, Callback cb) {
+  return ScheduleAfter(delay, Duration::Zero(), std::move(cb));
+}
+
+uint64_t EventLoopGroup::ScheduleAfter(Duration delay, Duration slack,
+                                       Callback cb) {
   size_t loop_id = next();
-  uint64_t timer_id = loops_[loop_id].ScheduleAfter(delay, std::move(cb));
+  uint64_t timer_id =
+      loops_[loop_id]->ScheduleAfter(delay, slack, std::move(cb));
   return timer_id * loops_.size() + loop_id;
 }
 
 uint64_t EventLoopGroup::ScheduleEvery(Duration delay, Duration interval,
                                        Callback cb) {
+  return ScheduleEvery(delay, interval, Duration::Zero(), std::move(cb));
+}
+
+uint64_t EventLoopGroup::ScheduleEvery(Duration delay, Duration interval,
+                                       Duration slack, Callback cb) {
   size_t loop_id = next();
   uint64_t timer_id =
-      loops_[loop_id].ScheduleEvery(delay, interval, std::move(cb));
+      loops_[loop_id]->ScheduleEvery(delay, interval, slack, std::move(cb));
   return timer_id * loops_.size() + loop_id;
 }
 
 void EventLoopGroup::ScheduleCancel(uint64_t id) {
   size_t loop_id = id % loops_.size();
   size_t timer_id = id / loops_.size();
-  loops_[loop_id].ScheduleCancel(timer_id);
+  loops_[loop_id]->ScheduleCancel(timer_id);
 }
 
 void EventLoopGroup::Close() {
+  if (watchdog_ != nullptr) {
+    watchdog_->Stop();
+  }
   for (auto& loop : loops_) {
-    loop.Close();
+    loop->Close();
   }
 }
 
@@ -43,6 +147,17 @@ void EventLoopGroup::HandleJoin() {
     }
   }
   threads_.clear();
+  if (watchdog_ != nullptr) {
+    watchdog_->Join();
+  }
+}
+
+LoopMetrics::Snapshot EventLoopGroup::GetMetrics() {
+  LoopMetrics::Snapshot metrics;
+  for (auto& loop : loops_) {
+    metrics.Merge(loop->GetMetrics());
+  }
+  return metrics;
 }
 
 size_t EventLoopGroup::Size() const noexcept {
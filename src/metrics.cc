@@ -0,0 +1,69 @@
+#include "pedronet/metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace pedronet {
+
+void Histogram::Snapshot::Merge(const Snapshot& other) noexcept {
+  for (size_t i = 0; i < kBuckets; ++i) {
+    buckets[i] += other.buckets[i];
+  }
+  count += other.count;
+  sum += other.sum;
+  max = std::max(max, other.max);
+}
+
+double Histogram::Snapshot::Mean() const noexcept {
+  return count == 0 ? 0 : (double)sum / count;
+}
+
+uint64_t Histogram::Snapshot::Percentile(double p) const noexcept {
+  if (count == 0) {
+    return 0;
+  }
+
+  auto rank = std::max<uint64_t>(1, (uint64_t)std::ceil(p * count));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBuckets; ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      uint64_t upper = i == 0 ? 0 : (i == 64 ? UINT64_MAX : (1ull << i) - 1);
+      return std::min(upper, max);
+    }
+  }
+  return max;
+}
+
+Histogram::Snapshot Histogram::Get() const noexcept {
+  Snapshot snapshot;
+  for (size_t i = 0; i < kBuckets; ++i) {
+    snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+  snapshot.count = count_.load(std::memory_order_relaxed);
+  snapshot.sum = sum_.load(std::memory_order_relaxed);
+  snapshot.max = max_.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+void LoopMetrics::Snapshot::Merge(const Snapshot& other) noexcept {
+  wait_ns.Merge(other.wait_ns);
+  ready.Merge(other.ready);
+  dispatch_ns.Merge(other.dispatch_ns);
+  drain_ns.Merge(other.drain_ns);
+  tasks.Merge(other.tasks);
+  timer_lag_us.Merge(other.timer_lag_us);
+}
+
+LoopMetrics::Snapshot LoopMetrics::Get() const noexcept {
+  Snapshot snapshot;
+  snapshot.wait_ns = wait_ns.Get();
+  snapshot.ready = ready.Get();
+  snapshot.dispatch_ns = dispatch_ns.Get();
+  snapshot.drain_ns = drain_ns.Get();
+  snapshot.tasks = tasks.Get();
+  snapshot.timer_lag_us = timer_lag_us.Get();
+  return snapshot;
+}
+
+}  // namespace pedronet
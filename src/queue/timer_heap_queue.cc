@@ -3,51 +3,150 @@
 
 namespace pedronet {
 
+TimerHeapQueue::Entry* TimerHeapQueue::internalInsert(Timestamp expire,
+                                                      Duration interval,
+                                                      Duration slack,
+                                                      Task callback) {
+  Entry* entry = slab_.Allocate();
+  if (positions_.size() < slab_.Capacity()) {
+    positions_.resize(slab_.Capacity(), kNoPosition);
+  }
+  entry->callback = std::move(callback);
+  entry->interval = interval;
+  entry->slack = slack;
+
+  heap_.push_back(Node{expire, entry->index});
+  internalSiftUp(heap_.size() - 1);
+
+  // The channel is armed for the top already otherwise.
+  if (positions_[entry->index] == 0) {
+    channel_->WakeUpAt(expire);
+  }
+  return entry;
+}
+
+void TimerHeapQueue::internalFree(Entry* entry) {
+  entry->callback = nullptr;
+  positions_[entry->index] = kNoPosition;
+  entry->running = false;
+  entry->cancelled = false;
+  slab_.Free(entry);
+}
+
+void TimerHeapQueue::internalSiftUp(size_t position) noexcept {
+  Node node = heap_[position];
+  while (position > 0) {
+    size_t parent = (position - 1) / kArity;
+    if (!(node.expire < heap_[parent].expire)) {
+      break;
+    }
+    internalPlace(position, heap_[parent]);
+    position = parent;
+  }
+  internalPlace(position, node);
+}
+
+void TimerHeapQueue::internalSiftDown(size_t position) noexcept {
+  // The node is usually among the latest ones, so the hole goes all the way
+  // down first and the node is sifted up from the leaf, which saves the
+  // compares against it on the way down.
+  Node node = heap_[position];
+  size_t top = position;
+  size_t n = heap_.size();
+  for (size_t first; (first = position * kArity + 1) < n;) {
+    size_t last = std::min(first + kArity, n);
+    size_t min = first;
+    for (size_t child = first + 1; child < last; ++child) {
+      min = heap_[child].expire < heap_[min].expire ? child : min;
+    }
+    internalPlace(position, heap_[min]);
+    position = min;
+  }
+
+  while (position > top) {
+    size_t parent = (position - 1) / kArity;
+    if (!(node.expire < heap_[parent].expire)) {
+      break;
+    }
+    internalPlace(position, heap_[parent]);
+    position = parent;
+  }
+  internalPlace(position, node);
+}
+
+void TimerHeapQueue::internalRemove(size_t position) noexcept {
+  Node last = heap_.back();
+  heap_.pop_back();
+  if (position == heap_.size()) {
+    return;
+  }
+
+  internalPlace(position, last);
+  if (position > 0 && last.expire < heap_[(position - 1) / kArity].expire) {
+    internalSiftUp(position);
+  } else {
+    internalSiftDown(position);
+  }
+}
+
 uint64_t TimerHeapQueue::Add(Duration delay, Duration interval,
-                             Callback callback) {
-  Timestamp expired = Timestamp::Now() + delay;
-  uint64_t id = counter_.fetch_add(1, std::memory_order_relaxed) + 1;
-  auto timer = std::make_shared<Entry>(id, std::move(callback), interval);
+                             Duration slack, Task callback) {
+  Timestamp expire = ApplySlack(Timestamp::Now() + delay, slack);
+  Entry* entry = internalInsert(expire, interval, slack, std::move(callback));
+  return slab_.GetId(entry);
+}
 
-  std::unique_lock lock(mu_);
-  queue_.emplace(expired, timer);
-  table_.emplace(id, std::move(timer));
-  channel_->WakeUpAt(expired);
-  return id;
+void TimerHeapQueue::internalAdd(uint64_t id, Timestamp expire,
+                                 Duration interval, Duration slack,
+                                 Task callback) {
+  Entry* entry = internalInsert(expire, interval, slack, std::move(callback));
+  slab_.Alias(entry, id);
 }
 
-void TimerHeapQueue::Cancel(uint64_t timer_id) {
-  std::unique_lock lock(mu_);
-  table_.erase(timer_id);
+void TimerHeapQueue::internalCancel(uint64_t id) {
+  Entry* entry = slab_.Find(id);
+  if (entry == nullptr) {
+    return;
+  }
+
+  // A running timer is released by Process() once its callback returns.
+  if (entry->running) {
+    entry->cancelled = true;
+    return;
+  }
+  internalRemove(positions_[entry->index]);
+  internalFree(entry);
 }
 
 void TimerHeapQueue::Process() {
+  internalDrainStaged();
   Timestamp now = Timestamp::Now();
 
-  std::unique_lock lock(mu_);
-  while (!queue_.empty() && queue_.top().expire <= now) {
-    auto item = queue_.top();
-    queue_.pop();
-
-    auto timer = item.timer.lock();
-    if (timer == nullptr) {
-      continue;
-    }
+  while (!heap_.empty() && heap_[0].expire <= now) {
+    Node top = heap_[0];
 
-    lock.unlock();
-    timer->callback();
-    lock.lock();
+    // Slab entries never move, so the callback may add timers while it runs.
+    Entry& entry = slab_.Get(top.entry);
+    entry.running = true;
+#ifdef PEDRONET_METRICS
+    RecordLag(top.expire);
+#endif
+    entry.callback();
 
-    if (timer->interval > Duration::Zero()) {
-      Timestamp expire = Timestamp::Now() + timer->interval;
-      queue_.emplace(expire, timer);
+    entry.running = false;
+    if (entry.interval > Duration::Zero() && !entry.cancelled) {
+      uint32_t position = positions_[top.entry];
+      heap_[position].expire =
+          ApplySlack(Timestamp::Now() + entry.interval, entry.slack);
+      internalSiftDown(position);
     } else {
-      table_.erase(timer->id);
+      internalRemove(positions_[top.entry]);
+      internalFree(&entry);
     }
   }
 
-  if (!queue_.empty()) {
-    channel_->WakeUpAt(queue_.top().expire);
+  if (!heap_.empty()) {
+    channel_->WakeUpAt(heap_[0].expire);
   }
 }
 }  // namespace pedronet
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "pedronet/queue/timer_wheel.h"
+#include "pedronet/logger/logger.h"
+
+namespace pedronet {
+
+TimerWheel::TimerWheel(TimerChannel* channel, const Options& options)
+    : TimerQueue(channel),
+      tick_(options.tick),
+      now_(GetTicks(Timestamp::Now())) {}
+
+void TimerWheel::internalFree(Entry* entry) {
+  entry->callback = nullptr;
+  entry->state = State::kFree;
+  entry->cancelled = false;
+  slab_.Free(entry);
+}
+
+void TimerWheel::internalLink(Entry* entry, uint64_t earliest) {
+  uint64_t delta = std::min(std::max(entry->expire, earliest) - now_,
+                            kMaxDelta);
+  uint64_t expire = now_ + delta;
+
+  // The coarsest level whose slots still tell the ticks of delta apart.
+  size_t level = 0;
+  if (delta >= kSlots) {
+    level = (63 - __builtin_clzll(delta)) / kSlotBits;
+  }
+  size_t slot = (expire >> (kSlotBits * level)) & (kSlots - 1);
+
+  levels_[level].slots[slot].PushBack(entry);
+  levels_[level].occupied |= uint64_t{1} << slot;
+  entry->level = level;
+  entry->slot = slot;
+  entry->state = State::kLinked;
+}
+
+void TimerWheel::internalUnlink(Entry* entry) {
+  Slot::Unlink(entry);
+  Level& level = levels_[entry->level];
+  if (level.slots[entry->slot].Empty()) {
+    level.occupied &= ~(uint64_t{1} << entry->slot);
+  }
+}
+
+void TimerWheel::internalCascade(size_t level) {
+  size_t slot = (now_ >> (kSlotBits * level)) & (kSlots - 1);
+  Level& from = levels_[level];
+  if ((from.occupied & (uint64_t{1} << slot)) == 0) {
+    return;
+  }
+
+  Slot pending;
+  pending.Splice(from.slots[slot]);
+  from.occupied &= ~(uint64_t{1} << slot);
+  while (!pending.Empty()) {
+    internalLink(pending.PopFront(), now_);
+  }
+}
+
+uint64_t TimerWheel::internalNextTick() const noexcept {
+  uint64_t next = UINT64_MAX;
+  for (size_t level = 0; level < kLevels; ++level) {
+    uint64_t occupied = levels_[level].occupied;
+    if (occupied == 0) {
+      continue;
+    }
+
+    // Slot s of a level is reached again at the first multiple of its span
+    // after now_ whose index is s.
+    size_t shift = kSlotBits * level;
+    uint64_t base = ((now_ >> shift) + 1) << shift;
+    size_t first = (base >> shift) & (kSlots - 1);
+    uint64_t rotated = occupied;
+    if (first != 0) {
+      rotated = occupied >> first | occupied << (kSlots - first);
+    }
+    uint64_t k = __builtin_ctzll(rotated);
+    next = std::min(next, base + (k << shift));
+  }
+  return next;
+}
+
+TimerWheel::Entry* TimerWheel::internalInsert(Timestamp expire,
+                                              Duration interval,
+                                              Duration slack,
+                                              Task callback) {
+  Entry* entry = slab_.Allocate();
+  entry->expire = GetDeadline(expire);
+  entry->interval = interval;
+  entry->slack = slack;
+  entry->callback = std::move(callback);
+  internalLink(entry, now_ + 1);
+
+  uint64_t deadline = std::max(entry->expire, now_ + 1);
+  if (deadline < armed_) {
+    armed_ = deadline;
+    channel_->WakeUpAt(GetTimestamp(deadline));
+  }
+  return entry;
+}
+
+uint64_t TimerWheel::Add(Duration delay, Duration interval, Duration slack,
+                         Task callback) {
+  Timestamp expire = ApplySlack(Timestamp::Now() + delay, slack);
+  Entry* entry = internalInsert(expire, interval, slack, std::move(callback));
+  return slab_.GetId(entry);
+}
+
+void TimerWheel::internalAdd(uint64_t id, Timestamp expire, Duration interval,
+                             Duration slack, Task callback) {
+  Entry* entry = internalInsert(expire, interval, slack, std::move(callback));
+  slab_.Alias(entry, id);
+}
+
+void TimerWheel::internalCancel(uint64_t id) {
+  Entry* entry = slab_.Find(id);
+  if (entry == nullptr) {
+    return;
+  }
+
+  // A running timer is released by Process() once its callback returns.
+  if (entry->state == State::kRunning) {
+    entry->cancelled = true;
+    return;
+  }
+  internalUnlink(entry);
+  internalFree(entry);
+}
+
+void TimerWheel::Process() {
+  internalDrainStaged();
+  uint64_t target = GetTicks(Timestamp::Now());
+
+  for (uint64_t next; (next = internalNextTick()) <= target;) {
+    now_ = next;
+    for (size_t level = kLevels - 1; level > 0; --level) {
+      if ((now_ & ((uint64_t{1} << (kSlotBits * level)) - 1)) == 0) {
+        internalCascade(level);
+      }
+    }
+
+    // A cancel of an expired entry clears the bit of its emptied level 0
+    // slot again, which is harmless.
+    size_t slot = now_ & (kSlots - 1);
+    expired_.Splice(levels_[0].slots[slot]);
+    levels_[0].occupied &= ~(uint64_t{1} << slot);
+
+    while (!expired_.Empty()) {
+      Entry* entry = expired_.PopFront();
+      entry->state = State::kRunning;
+#ifdef PEDRONET_METRICS
+      RecordLag(GetTimestamp(entry->expire));
+#endif
+      entry->callback();
+
+      if (entry->interval > Duration::Zero() && !entry->cancelled) {
+        Timestamp expire = Timestamp::Now() + entry->interval;
+        entry->expire = GetDeadline(ApplySlack(expire, entry->slack));
+        internalLink(entry, now_ + 1);
+      } else {
+        internalFree(entry);
+      }
+    }
+  }
+  now_ = std::max(now_, target);
+
+  armed_ = internalNextTick();
+  if (armed_ != UINT64_MAX) {
+    channel_->WakeUpAt(GetTimestamp(armed_));
+  }
+}
+
+}  // namespace pedronet
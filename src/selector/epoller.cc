@@ -1,9 +1,19 @@
 #include "pedronet/selector/epoller.h"
 #include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include "pedronet/logger/logger.h"
 
+#ifndef SYS_epoll_pwait2
+#define SYS_epoll_pwait2 441
+#endif
+
 namespace pedronet {
 
+inline static uint64_t MakeSlotId(uint32_t index, uint32_t generation) {
+  return (uint64_t)generation << 32 | index;
+}
+
 inline static File CreateEpollFile() {
   int fd = ::epoll_create1(EPOLL_CLOEXEC);
   if (fd <= 0) {
@@ -16,42 +26,116 @@ EpollSelector::EpollSelector() : fd_(CreateEpollFile()), buf_(256) {}
 
 EpollSelector::~EpollSelector() = default;
 
-void EpollSelector::internalUpdate(Channel* channel, int op,
+void EpollSelector::internalUpdate(Channel* channel, uint64_t id, int op,
                                    SelectEvents events) {
   struct epoll_event ev {};
   ev.events = events.Value();
-  ev.data.ptr = channel;
+  ev.data.u64 = id;
   int efd = fd_.Descriptor();
   int cfd = channel->GetFile().Descriptor();
   if (::epoll_ctl(efd, op, cfd, op == EPOLL_CTL_DEL ? nullptr : &ev)) {
     PEDRONET_FATAL("epoll_ctl({}) failed, reason[{}]", *channel, Error{errno});
   }
+  updates_.store(updates_.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_relaxed);
 }
 
 void EpollSelector::Add(const Channel::Ptr& channel, SelectEvents events) {
-  channel_.emplace(channel.get(), channel);
-  internalUpdate(channel.get(), EPOLL_CTL_ADD, events);
+  uint32_t index = slots_.size();
+  if (free_.empty()) {
+    slots_.emplace_back();
+  } else {
+    index = free_.back();
+    free_.pop_back();
+  }
+
+  Slot& slot = slots_[index];
+  slot.channel = channel;
+  slot.dirty = false;
+  slot.events = events;
+  uint64_t id = MakeSlotId(index, slot.generation);
+  channel_.emplace(channel.get(), id);
+  internalUpdate(channel.get(), id, EPOLL_CTL_ADD, events);
 }
 
 void EpollSelector::Update(Channel* channel, SelectEvents events) {
   auto it = channel_.find(channel);
-  if (it != channel_.end()) {
-    internalUpdate(channel, EPOLL_CTL_MOD, events);
+  if (it == channel_.end()) {
+    return;
+  }
+
+  auto index = (uint32_t)it->second;
+  Slot& slot = slots_[index];
+  slot.pending = events;
+  if (!slot.dirty) {
+    slot.dirty = true;
+    dirty_.emplace_back(index);
+  }
+}
+
+void EpollSelector::Flush() {
+  for (uint32_t index : dirty_) {
+    Slot& slot = slots_[index];
+    if (!slot.dirty) {
+      continue;
+    }
+    slot.dirty = false;
+    if (slot.pending != slot.events) {
+      slot.events = slot.pending;
+      internalUpdate(slot.channel.get(), MakeSlotId(index, slot.generation),
+                     EPOLL_CTL_MOD, slot.events);
+    }
   }
+  dirty_.clear();
 }
 
 void EpollSelector::Remove(const Channel::Ptr& channel) {
   auto it = channel_.find(channel.get());
   if (it != channel_.end()) {
-    internalUpdate(channel.get(), EPOLL_CTL_DEL, SelectEvents::kNoneEvent);
-    channel_.erase(channel.get());
+    internalUpdate(channel.get(), it->second, EPOLL_CTL_DEL,
+                   SelectEvents::kNoneEvent);
+
+    auto index = (uint32_t)it->second;
+    channel_.erase(it);
+
+    // Pending events of this slot carry the old generation and are dropped.
+    // The channel itself is kept until the next Wait(), the events being
+    // dispatched may still refer to it.
+    Slot& slot = slots_[index];
+    slot.generation++;
+    slot.dirty = false;
+    released_.emplace_back(std::move(slot.channel));
+    free_.emplace_back(index);
   }
 }
 
-Error EpollSelector::Wait(Duration timeout) {
+int EpollSelector::internalWait(Duration timeout) {
   int efd = fd_.Descriptor();
-  int n = ::epoll_wait(efd, buf_.data(), (int)buf_.size(),
-                       (int)timeout.Milliseconds());
+  int64_t usec = std::max<int64_t>(timeout.Microseconds(), 0);
+
+  // epoll_pwait2(2) takes a timespec, but only exists since Linux 5.11.
+  if (pwait2_) {
+    struct timespec ts {};
+    ts.tv_sec = usec / Duration::kMicroseconds;
+    ts.tv_nsec = (usec % Duration::kMicroseconds) * 1000;
+    long n = ::syscall(SYS_epoll_pwait2, efd, buf_.data(), (int)buf_.size(),
+                       &ts, nullptr, 0);
+    if (n >= 0 || (errno != ENOSYS && errno != EPERM)) {
+      return (int)n;
+    }
+    PEDRONET_TRACE("epoll_pwait2 is not available, use epoll_wait instead");
+    pwait2_ = false;
+  }
+
+  // Round up, waking up before the deadline only spins until it is reached.
+  int ms = (int)((usec + 999) / 1000);
+  return ::epoll_wait(efd, buf_.data(), (int)buf_.size(), ms);
+}
+
+Error EpollSelector::Wait(Duration timeout) {
+  released_.clear();
+
+  int n = internalWait(timeout);
 
   len_ = std::max(0, n);
   if (len_ == buf_.size() && len_ < 65536) {
@@ -65,12 +149,12 @@ size_t EpollSelector::Size() const {
 }
 
 SelectChannel EpollSelector::Get(size_t index) const {
-  auto* ptr = (Channel*)buf_[index].data.ptr;
-  auto it = channel_.find(ptr);
-  if (it != channel_.end()) {
-    return {it->second, ReceiveEvents{buf_[index].events}};
+  const struct epoll_event& ev = buf_[index];
+  const Slot& slot = slots_[(uint32_t)ev.data.u64];
+  if (slot.generation != (uint32_t)(ev.data.u64 >> 32)) {
+    return {nullptr, ReceiveEvents{ev.events}};
   }
-  return {nullptr, ReceiveEvents{buf_[index].events}};
+  return {slot.channel.get(), ReceiveEvents{ev.events}};
 }
 
 bool EpollSelector::Contain(const Channel::Ptr& channel) const noexcept {
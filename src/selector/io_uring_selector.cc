@@ -0,0 +1,652 @@
+#include "pedronet/selector/io_uring_selector.h"
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include "pedronet/logger/logger.h"
+
+namespace pedronet {
+
+namespace {
+
+constexpr unsigned kSubmissionEntries = 1024;
+constexpr unsigned kCompletionEntries = 8192;
+
+// user_data of the requests whose completion carries no readiness, such as
+// poll removals and updates. Entries are aligned, so it never collides.
+constexpr uint64_t kControlData = 1;
+
+// Tags the user_data of the multishot accept and receive of an entry, so they
+// are told apart from its poll.
+constexpr uint64_t kOperationTag = 2;
+
+// The provided buffer ring shared by the multishot receives of a selector.
+constexpr uint16_t kBufferGroup = 0;
+constexpr unsigned kBufferCount = 2048;
+constexpr unsigned kBufferSize = 4096;
+
+// EPOLLET and friends live in the upper bits and are meaningless for a oneshot
+// poll request.
+constexpr uint32_t kPollMask = 0xffff;
+
+// Both of them arrived before poll updates (5.13), they are used to reject the
+// kernels that are unable to run IoUringSelector.
+constexpr uint32_t kRequiredFeatures =
+    IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG | IORING_FEAT_RSRC_TAGS;
+
+inline int IoUringSetup(unsigned entries, struct io_uring_params* params) {
+  return (int)::syscall(__NR_io_uring_setup, entries, params);
+}
+
+inline int IoUringEnter(int fd, unsigned submit, unsigned wait, unsigned flags,
+                        void* arg, size_t size) {
+  return (int)::syscall(__NR_io_uring_enter, fd, submit, wait, flags, arg,
+                        size);
+}
+
+inline int IoUringRegister(int fd, unsigned opcode, void* arg,
+                           unsigned nr_args) {
+  return (int)::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+inline unsigned LoadAcquire(const unsigned* p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+inline void StoreRelease(unsigned* p, unsigned v) {
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+// The errors that end a multishot accept for good, the others such as EMFILE
+// or ENOMEM are transient and the accept is submitted again.
+inline bool IsAcceptBroken(int err) {
+  return err == EBADF || err == EINVAL || err == ENOTSOCK ||
+         err == EOPNOTSUPP;
+}
+
+inline File CreateIoUringFile(struct io_uring_params* params) {
+  params->flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+  params->cq_entries = kCompletionEntries;
+  int fd = IoUringSetup(kSubmissionEntries, params);
+  if (fd < 0 && errno == EINVAL) {
+    // IORING_SETUP_COOP_TASKRUN requires Linux 5.19.
+    params->flags &= ~IORING_SETUP_COOP_TASKRUN;
+    fd = IoUringSetup(kSubmissionEntries, params);
+  }
+  if (fd < 0) {
+    PEDRONET_FATAL("failed to create io_uring fd, errno[{}]", errno);
+  }
+  return File{fd};
+}
+
+}  // namespace
+
+struct IoUringSelector::Ring {
+  File fd;
+
+  void* sq_ptr{MAP_FAILED};
+  size_t sq_size{};
+  void* cq_ptr{MAP_FAILED};
+  size_t cq_size{};
+  io_uring_sqe* sqes{};
+  size_t sqes_size{};
+
+  unsigned* sq_head{};
+  unsigned* sq_tail{};
+  unsigned sq_mask{};
+  unsigned sq_entries{};
+  unsigned tail{};
+  unsigned pending{};
+
+  unsigned* cq_head{};
+  unsigned* cq_tail{};
+  unsigned cq_mask{};
+  io_uring_cqe* cqes{};
+
+  explicit Ring(struct io_uring_params& params)
+      : fd(CreateIoUringFile(&params)) {
+    int efd = fd.Descriptor();
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) {
+      sq_size = cq_size = std::max(sq_size, cq_size);
+    }
+
+    sq_ptr = ::mmap(nullptr, sq_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, efd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED) {
+      PEDRONET_FATAL("failed to mmap io_uring sq, errno[{}]", errno);
+    }
+
+    cq_ptr = sq_ptr;
+    if (!single) {
+      cq_ptr = ::mmap(nullptr, cq_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, efd, IORING_OFF_CQ_RING);
+    }
+    if (cq_ptr == MAP_FAILED) {
+      PEDRONET_FATAL("failed to mmap io_uring cq, errno[{}]", errno);
+    }
+
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* ptr = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, efd, IORING_OFF_SQES);
+    if (ptr == MAP_FAILED) {
+      PEDRONET_FATAL("failed to mmap io_uring sqes, errno[{}]", errno);
+    }
+    sqes = static_cast<io_uring_sqe*>(ptr);
+
+    auto* sq = static_cast<char*>(sq_ptr);
+    sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_entries = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    tail = *sq_tail;
+
+    // The submission queue entries are always consumed in order, so the
+    // indirection array is an identity mapping.
+    auto* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < sq_entries; ++i) {
+      array[i] = i;
+    }
+
+    auto* cq = static_cast<char*>(cq_ptr);
+    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+  }
+
+  ~Ring() {
+    if (sqes != nullptr) {
+      ::munmap(sqes, sqes_size);
+    }
+    if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) {
+      ::munmap(cq_ptr, cq_size);
+    }
+    if (sq_ptr != MAP_FAILED) {
+      ::munmap(sq_ptr, sq_size);
+    }
+  }
+};
+
+struct IoUringSelector::BufferRing {
+  io_uring_buf_ring* ring{};
+  size_t ring_size{};
+  char* data{};
+  size_t data_size{};
+
+  unsigned short tail{};
+  std::vector<uint16_t> used;
+
+  explicit BufferRing(int efd) {
+    ring_size = kBufferCount * sizeof(io_uring_buf);
+    void* ptr = ::mmap(nullptr, ring_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+      PEDRONET_FATAL("failed to mmap buffer ring, errno[{}]", errno);
+    }
+    ring = static_cast<io_uring_buf_ring*>(ptr);
+
+    data_size = (size_t)kBufferCount * kBufferSize;
+    ptr = ::mmap(nullptr, data_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+      PEDRONET_FATAL("failed to mmap buffers, errno[{}]", errno);
+    }
+    data = static_cast<char*>(ptr);
+
+    struct io_uring_buf_reg reg {};
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+    reg.ring_entries = kBufferCount;
+    reg.bgid = kBufferGroup;
+    if (IoUringRegister(efd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+      PEDRONET_FATAL("failed to register buffer ring, errno[{}]", errno);
+    }
+
+    used.reserve(kBufferCount);
+    for (unsigned i = 0; i < kBufferCount; ++i) {
+      Provide(i);
+    }
+    Publish();
+  }
+
+  ~BufferRing() {
+    ::munmap(data, data_size);
+    ::munmap(ring, ring_size);
+  }
+
+  char* Data(uint16_t bid) const noexcept {
+    return data + (size_t)bid * kBufferSize;
+  }
+
+  void Provide(uint16_t bid) noexcept {
+    // In C++ the empty member of __DECLARE_FLEX_ARRAY takes a byte and shifts
+    // bufs, so index the ring as a plain array instead.
+    auto* bufs = reinterpret_cast<io_uring_buf*>(ring);
+    io_uring_buf& buf = bufs[tail & (kBufferCount - 1)];
+    buf.addr = reinterpret_cast<uint64_t>(Data(bid));
+    buf.len = kBufferSize;
+    buf.bid = bid;
+    tail++;
+  }
+
+  void Publish() noexcept {
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+  }
+
+  // The buffers handed out in the last round are owned by the kernel again.
+  void Recycle() noexcept {
+    if (used.empty()) {
+      return;
+    }
+    for (uint16_t bid : used) {
+      Provide(bid);
+    }
+    used.clear();
+    Publish();
+  }
+};
+
+bool IoUringSelector::Supported() noexcept {
+  static const bool supported = [] {
+    struct io_uring_params params {};
+    int fd = IoUringSetup(2, &params);
+    if (fd < 0) {
+      return false;
+    }
+    ::close(fd);
+    return (params.features & kRequiredFeatures) == kRequiredFeatures;
+  }();
+  return supported;
+}
+
+bool IoUringSelector::SupportedCompletion() noexcept {
+  // IORING_SETUP_SINGLE_ISSUER arrived together with multishot receive.
+  static const bool supported = [] {
+    if (!Supported()) {
+      return false;
+    }
+    struct io_uring_params params {};
+    params.flags = IORING_SETUP_SINGLE_ISSUER;
+    int fd = IoUringSetup(2, &params);
+    if (fd < 0) {
+      return false;
+    }
+    ::close(fd);
+    return true;
+  }();
+  return supported;
+}
+
+IoUringSelector::IoUringSelector() {
+  struct io_uring_params params {};
+  ring_ = std::make_unique<Ring>(params);
+  if (SupportedCompletion()) {
+    buffers_ = std::make_unique<BufferRing>(ring_->fd.Descriptor());
+  }
+  ready_.reserve(256);
+}
+
+IoUringSelector::~IoUringSelector() = default;
+
+IoUringSelector::Entry* IoUringSelector::internalAllocate() {
+  if (free_.empty()) {
+    return entries_.emplace_back(std::make_unique<Entry>()).get();
+  }
+  Entry* entry = free_.back();
+  free_.pop_back();
+  return entry;
+}
+
+io_uring_sqe* IoUringSelector::internalPrepare() {
+  auto& r = *ring_;
+  if (r.tail - LoadAcquire(r.sq_head) == r.sq_entries) {
+    // The submission queue is full, hand the prepared requests to the kernel
+    // without waiting for any completion.
+    int n = internalEnter(0, Duration::Zero());
+    if (n < 0) {
+      PEDRONET_FATAL("failed to submit io_uring requests, errno[{}]", -n);
+    }
+  }
+
+  io_uring_sqe* sqe = &r.sqes[r.tail & r.sq_mask];
+  std::memset(sqe, 0, sizeof(*sqe));
+  r.tail++;
+  r.pending++;
+  return sqe;
+}
+
+void IoUringSelector::internalArm(Entry* entry) {
+  uint32_t events = entry->events.Value() & kPollMask;
+  if (entry->armed || events == 0) {
+    return;
+  }
+
+  io_uring_sqe* sqe = internalPrepare();
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = entry->channel->GetFile().Descriptor();
+  sqe->poll32_events = events;
+  sqe->user_data = reinterpret_cast<uint64_t>(entry);
+  entry->armed = true;
+  entry->armed_events = entry->events;
+}
+
+void IoUringSelector::internalSubmit(Entry* entry) {
+  if (entry->submitted || entry->operation == SelectOperation::kNone) {
+    return;
+  }
+
+  io_uring_sqe* sqe = internalPrepare();
+  sqe->fd = entry->channel->GetFile().Descriptor();
+  sqe->user_data = reinterpret_cast<uint64_t>(entry) | kOperationTag;
+  if (entry->operation == SelectOperation::kAccept) {
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+  } else {
+    sqe->opcode = IORING_OP_RECV;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = kBufferGroup;
+  }
+  entry->submitted = true;
+}
+
+bool IoUringSelector::internalOperate(Channel* channel,
+                                      SelectOperation operation) {
+  if (buffers_ == nullptr) {
+    return false;
+  }
+  auto it = channels_.find(channel);
+  if (it == channels_.end()) {
+    return false;
+  }
+
+  Entry* entry = it->second;
+  entry->operation = operation;
+  internalSubmit(entry);
+  return true;
+}
+
+void IoUringSelector::internalRelease(Entry* entry) {
+  if (!entry->armed && !entry->submitted) {
+    garbage_.emplace_back(entry);
+  }
+}
+
+void IoUringSelector::internalComplete(Entry* entry, const io_uring_cqe& cqe) {
+  if (!(cqe.flags & IORING_CQE_F_MORE)) {
+    entry->submitted = false;
+  }
+
+  const char* data = nullptr;
+  if (cqe.flags & IORING_CQE_F_BUFFER) {
+    auto bid = (uint16_t)(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    buffers_->used.emplace_back(bid);
+    data = buffers_->Data(bid);
+  }
+
+  if (entry->channel == nullptr) {
+    if (entry->operation == SelectOperation::kAccept && cqe.res >= 0) {
+      ::close(cqe.res);
+    }
+    internalRelease(entry);
+    return;
+  }
+
+  // The multishot request has been terminated by the kernel, keep it alive
+  // unless the peer or the socket has come to an end.
+  SelectCompletion completion{entry->operation, cqe.res, data};
+  bool more = cqe.flags & IORING_CQE_F_MORE;
+  if (cqe.res == -ENOBUFS || cqe.res == -ECANCELED) {
+    resubmit_.emplace_back(entry);
+    return;
+  }
+  if (!more) {
+    bool accept = entry->operation == SelectOperation::kAccept;
+    if (cqe.res > 0 || (accept && !IsAcceptBroken(-cqe.res))) {
+      resubmit_.emplace_back(entry);
+    } else {
+      entry->operation = SelectOperation::kNone;
+    }
+  }
+
+  ready_.push_back({entry, ReceiveEvents::kCompletion, completion});
+}
+
+int IoUringSelector::internalEnter(unsigned wait, Duration timeout) {
+  auto& r = *ring_;
+  StoreRelease(r.sq_tail, r.tail);
+
+  struct __kernel_timespec ts {};
+  struct io_uring_getevents_arg arg {};
+  unsigned flags = 0;
+  void* argp = nullptr;
+  size_t size = 0;
+
+  if (wait != 0) {
+    int64_t usec = timeout.Microseconds();
+    ts.tv_sec = usec / Duration::kMicroseconds;
+    ts.tv_nsec = (usec % Duration::kMicroseconds) * 1000;
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+    flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    argp = &arg;
+    size = sizeof(arg);
+  }
+
+  int n = IoUringEnter(r.fd.Descriptor(), r.pending, wait, flags, argp, size);
+  if (n < 0) {
+    return -errno;
+  }
+  r.pending -= std::min(r.pending, (unsigned)n);
+  return n;
+}
+
+void IoUringSelector::internalReap() {
+  auto& r = *ring_;
+  unsigned head = *r.cq_head;
+  unsigned tail = LoadAcquire(r.cq_tail);
+
+  for (; head != tail; ++head) {
+    const io_uring_cqe& cqe = r.cqes[head & r.cq_mask];
+    if (cqe.user_data == kControlData) {
+      continue;
+    }
+
+    if (cqe.user_data & kOperationTag) {
+      internalComplete(
+          reinterpret_cast<Entry*>(cqe.user_data & ~kOperationTag), cqe);
+      continue;
+    }
+
+    auto* entry = reinterpret_cast<Entry*>(cqe.user_data);
+    entry->armed = false;
+
+    if (entry->channel == nullptr) {
+      internalRelease(entry);
+      continue;
+    }
+
+    if (cqe.res == -ECANCELED) {
+      internalArm(entry);
+      continue;
+    }
+
+    uint32_t events = cqe.res < 0 ? POLLERR : (uint32_t)cqe.res;
+    ready_.push_back({entry, ReceiveEvents{events}, {}});
+  }
+
+  StoreRelease(r.cq_head, head);
+}
+
+void IoUringSelector::Add(const Channel::Ptr& channel, SelectEvents events) {
+  Entry* entry = internalAllocate();
+  entry->channel = channel;
+  entry->events = events;
+  entry->operation = SelectOperation::kNone;
+  entry->armed = false;
+  entry->submitted = false;
+  entry->dirty = false;
+  channels_.emplace(channel.get(), entry);
+  internalArm(entry);
+}
+
+void IoUringSelector::Update(Channel* channel, SelectEvents events) {
+  auto it = channels_.find(channel);
+  if (it == channels_.end()) {
+    return;
+  }
+
+  Entry* entry = it->second;
+  entry->events = events;
+  if (!entry->dirty) {
+    entry->dirty = true;
+    dirty_.emplace_back(entry);
+  }
+}
+
+void IoUringSelector::Flush() {
+  for (Entry* entry : dirty_) {
+    if (!entry->dirty) {
+      continue;
+    }
+    entry->dirty = false;
+
+    if (!entry->armed) {
+      internalArm(entry);
+      continue;
+    }
+
+    uint32_t mask = entry->events.Value() & kPollMask;
+    if (mask == (entry->armed_events.Value() & kPollMask)) {
+      continue;
+    }
+
+    // Modify the armed poll in place. If it has already completed, the update
+    // fails quietly and the new events are armed after the completion is
+    // dispatched.
+    io_uring_sqe* sqe = internalPrepare();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uint64_t>(entry);
+    sqe->len = mask != 0 ? IORING_POLL_UPDATE_EVENTS : 0;
+    sqe->poll32_events = mask;
+    sqe->user_data = kControlData;
+    entry->armed_events = entry->events;
+    updates_.store(updates_.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+  }
+  dirty_.clear();
+}
+
+void IoUringSelector::Remove(const Channel::Ptr& channel) {
+  auto it = channels_.find(channel.get());
+  if (it == channels_.end()) {
+    return;
+  }
+
+  Entry* entry = it->second;
+  channels_.erase(it);
+  released_.emplace_back(std::move(entry->channel));
+  entry->dirty = false;
+
+  if (!entry->armed && !entry->submitted) {
+    garbage_.emplace_back(entry);
+    return;
+  }
+
+  // The entry is recycled once the cancelled requests complete.
+  if (entry->armed) {
+    io_uring_sqe* sqe = internalPrepare();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uint64_t>(entry);
+    sqe->user_data = kControlData;
+  }
+  if (entry->submitted) {
+    io_uring_sqe* sqe = internalPrepare();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uint64_t>(entry) | kOperationTag;
+    sqe->user_data = kControlData;
+  }
+}
+
+bool IoUringSelector::Accept(Channel* channel) {
+  return internalOperate(channel, SelectOperation::kAccept);
+}
+
+bool IoUringSelector::Receive(Channel* channel) {
+  return internalOperate(channel, SelectOperation::kReceive);
+}
+
+Error IoUringSelector::Wait(Duration timeout) {
+  released_.clear();
+
+  // Polls are oneshot, re-arm the channels dispatched in the last round. The
+  // requests are submitted by the same io_uring_enter(2) that waits.
+  for (auto& ready : ready_) {
+    Entry* entry = ready.entry;
+    if (entry->channel != nullptr &&
+        !ready.events.Contains(ReceiveEvents::kCompletion)) {
+      internalArm(entry);
+    }
+  }
+  ready_.clear();
+
+  // The received bytes have been consumed, so the buffers can be refilled
+  // before the terminated receives are resubmitted.
+  if (buffers_ != nullptr) {
+    buffers_->Recycle();
+  }
+  for (Entry* entry : resubmit_) {
+    if (entry->channel != nullptr) {
+      internalSubmit(entry);
+    }
+  }
+  resubmit_.clear();
+
+  free_.insert(free_.end(), garbage_.begin(), garbage_.end());
+  garbage_.clear();
+
+  int n = internalEnter(timeout > Duration::Zero() ? 1 : 0, timeout);
+  internalReap();
+
+  if (n < 0) {
+    switch (-n) {
+      case ETIME:
+      case EINTR:
+      case EBUSY:
+      case EAGAIN:
+        break;
+      default:
+        return Error{-n};
+    }
+  }
+  return Error::Success();
+}
+
+size_t IoUringSelector::Size() const {
+  return ready_.size();
+}
+
+SelectChannel IoUringSelector::Get(size_t index) const {
+  auto& ready = ready_[index];
+  return {ready.entry->channel.get(), ready.events};
+}
+
+const SelectCompletion& IoUringSelector::GetCompletion(size_t index) const {
+  return ready_[index].completion;
+}
+
+bool IoUringSelector::Contain(const Channel::Ptr& channel) const noexcept {
+  return channels_.count(channel.get()) != 0;
+}
+
+}  // namespace pedronet
@@ -90,6 +90,14 @@ void Socket::SetTcpNoDelay(bool on) {
   ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(val));
 }
 
+void Socket::SetBusyPoll(Duration timeout) {
+  int val = (int)timeout.Microseconds();
+  if (::setsockopt(fd_, SOL_SOCKET, SO_BUSY_POLL, &val, sizeof(val)) < 0) {
+    PEDRONET_WARN("{}::SetBusyPoll({}) failed: {}", *this, timeout,
+                  Error{errno});
+  }
+}
+
 void Socket::CloseWrite() {
   if (::shutdown(fd_, SHUT_WR) < 0) {
     PEDRONET_FATAL("failed to close write end");
@@ -153,6 +161,9 @@ void Socket::SetOptions(const SocketOptions& options) {
   SetReuseAddr(options.reuse_addr);
   SetReusePort(options.reuse_port);
   SetTcpNoDelay(options.tcp_no_delay);
+  if (options.busy_poll > Duration::Zero()) {
+    SetBusyPoll(options.busy_poll);
+  }
 }
 
 }  // namespace pedronet
\ No newline at end of file
@@ -50,8 +50,11 @@ void TcpClient::handleConnection(Socket socket) {
   auto conn = std::make_shared<TcpConnection>(*eventloop_, std::move(socket));
   conn->SetHandler(std::make_shared<TcpClientChannelHandler>(
       conn->GetChannelContext(), this));
-  conn->Start();
+  conn->SetTrigger(options_.options.trigger);
+  // Published before Start(), OnConnect() may run inside it and the handler
+  // may expect Send() to work.
   conn_ = conn;
+  conn->Start();
 }
 
 void TcpClient::raiseConnection() {
@@ -13,9 +13,13 @@ void TcpConnection::Start() {
   channel_->OnClose([this](auto events, auto now) { handleClose(); });
   channel_->OnError(
       [this](auto, auto now) { handleError(channel_->GetError()); });
-  channel_->SetSelector(eventloop_.GetSelector());
+  channel_->OnComplete([this](const auto& completion, auto now) {
+    handleReceive(completion, now);
+  });
+  channel_->SetSelector(eventloop_.load()->GetSelector());
+  channel_->SetTrigger(trigger_);
 
-  eventloop_.Add(channel_, [this, self] {
+  eventloop_.load()->Add(channel_, [this, self] {
     State s = State::kConnecting;
     if (!state_.compare_exchange_strong(s, State::kConnected)) {
       PEDRONET_ERROR("{} has been register to channel", *this);
@@ -24,27 +28,70 @@ void TcpConnection::Start() {
 
     PEDRONET_INFO("handleConnection {}", *this);
     handler_->OnConnect(Timestamp::Now());
-    channel_->SetReadable(true);
+    receiving_ = channel_->SubmitReceive();
+    if (!receiving_) {
+      channel_->SetReadable(true);
+    }
   });
 }
 
 void TcpConnection::handleRead(Timestamp now) {
-  ssize_t n = input_.Append(&channel_->GetFile());
-  if (n < 0) {
-    auto err = Error{errno};
-    if (err.GetCode() != EWOULDBLOCK && err.GetCode() != EAGAIN) {
-      handleError(err);
+  // An edge-triggered channel is not notified again until it has been drained.
+  bool drain = channel_->GetTrigger() == SelectTrigger::kEdge;
+  do {
+    ssize_t n = input_.Append(&channel_->GetFile());
+    if (n < 0) {
+      auto err = Error{errno};
+      if (err.GetCode() != EWOULDBLOCK && err.GetCode() != EAGAIN) {
+        handleError(err);
+      }
+      return;
     }
+
+    if (n == 0) {
+      PEDRONET_INFO("close because no data");
+      handleClose();
+      return;
+    }
+
+    traffic_.fetch_add(n, std::memory_order_relaxed);
+    handler_->OnRead(now, input_);
+  } while (drain && state_ != State::kDisconnected);
+}
+
+void TcpConnection::handleReceive(const SelectCompletion& completion,
+                                  Timestamp now) {
+  if (completion.result < 0) {
+    handleError(Error{-completion.result});
+    handleClose();
     return;
   }
 
-  if (n == 0) {
+  if (completion.result == 0) {
     PEDRONET_INFO("close because no data");
     handleClose();
     return;
   }
+  traffic_.fetch_add(completion.result, std::memory_order_relaxed);
+
+  if (input_.ReadableBytes() != 0) {
+    input_.Append(completion.data, completion.result);
+    handler_->OnRead(now, input_);
+    return;
+  }
 
-  handler_->OnRead(now, input_);
+  // Nothing is pending, so the bytes are handed out through a buffer shared by
+  // the connections of this thread, and only the unconsumed tail is kept in
+  // input_. Idle connections hold no received data at all.
+  static thread_local ArrayBuffer scratch;
+  scratch.Append(completion.data, completion.result);
+  reading_ = &scratch;
+  handler_->OnRead(now, scratch);
+  reading_ = &input_;
+  if (scratch.ReadableBytes() != 0) {
+    input_.Append(scratch.ReadIndex(), scratch.ReadableBytes());
+  }
+  scratch.Reset();
 }
 
 void TcpConnection::handleError(Error err) {
@@ -61,13 +108,21 @@ void TcpConnection::handleWrite() {
     return;
   }
 
-  if (output_.ReadableBytes()) {
+  bool drain = channel_->GetTrigger() == SelectTrigger::kEdge;
+  while (output_.ReadableBytes()) {
     ssize_t n = channel_->Write(output_.ReadIndex(), output_.ReadableBytes());
     if (n < 0) {
-      handleError(channel_->GetError());
+      auto err = Error{errno};
+      if (err.GetCode() != EWOULDBLOCK && err.GetCode() != EAGAIN) {
+        handleError(err);
+      }
       return;
     }
     output_.Retrieve(n);
+    traffic_.fetch_add(n, std::memory_order_relaxed);
+    if (!drain) {
+      break;
+    }
   }
 
   if (output_.ReadableBytes() == 0) {
@@ -86,11 +141,10 @@ void TcpConnection::Close() {
     return;
   }
 
-  auto self = shared_from_this();
-  eventloop_.Run([=] {
+  internalRun([this, self = shared_from_this()] {
     if (output_.ReadableBytes() == 0) {
       PEDRONET_TRACE("{}::Close()", *this);
-      eventloop_.Remove(channel_, [=] { handleRemove(); });
+      eventloop_.load()->Remove(channel_, [this] { handleRemove(); });
     }
   });
 }
@@ -103,12 +157,105 @@ std::string TcpConnection::String() const {
 TcpConnection::TcpConnection(EventLoop& eventloop, Socket socket)
     : channel_(std::make_shared<SocketChannel>(std::move(socket))),
       local_(channel_->GetLocalAddress()),
-      eventloop_(eventloop),
+      eventloop_(&eventloop),
       context_(std::make_shared<ChannelContext>()),
-      close_latch_(1) {}
+      close_latch_(1) {
+  eventloop.AttachConnection();
+}
 
 TcpConnection::~TcpConnection() {
   PEDRONET_TRACE("{}", __func__);
+  eventloop_.load()->DetachConnection();
+}
+
+void TcpConnection::internalRun(Task task) {
+  EventLoop* loop = eventloop_.load();
+  if (EventLoop::GetEventLoop() == loop && !migrating_) {
+    task();
+    return;
+  }
+
+  {
+    std::unique_lock lock(mu_);
+    if (migrating_) {
+      deferred_.emplace_back(std::move(task));
+      return;
+    }
+    loop = eventloop_.load();
+    inflight_.fetch_add(1);
+  }
+  loop->Schedule([self = shared_from_this(), task = std::move(task)] {
+    self->inflight_.fetch_sub(1);
+    task();
+  });
+}
+
+bool TcpConnection::Migrate(EventLoop& target) {
+  if (receiving_ || state_ != State::kConnected) {
+    return false;
+  }
+
+  EventLoop* source;
+  {
+    std::unique_lock lock(mu_);
+    source = eventloop_.load();
+    if (migrating_ || source == &target) {
+      return false;
+    }
+    migrating_ = true;
+  }
+  source->Schedule([self = shared_from_this(), &target] {
+    self->internalMigrate(target);
+  });
+  return true;
+}
+
+void TcpConnection::internalMigrate(EventLoop& target) {
+  EventLoop* source = eventloop_.load();
+  // Tasks scheduled before the migration started still have to run here.
+  if (inflight_ != 0) {
+    source->Schedule([self = shared_from_this(), &target] {
+      self->internalMigrate(target);
+    });
+    return;
+  }
+
+  if (state_ != State::kConnected) {
+    internalResume();
+    return;
+  }
+
+  PEDRONET_TRACE("{}::Migrate()", *this);
+  source->Remove(channel_, {});
+  source->DetachConnection();
+  target.AttachConnection();
+  eventloop_ = &target;
+  channel_->SetSelector(target.GetSelector());
+
+  // The socket buffers keep whatever arrives in between, the output buffer
+  // and the interest of the channel move along with it.
+  target.Add(channel_, [self = shared_from_this()] {
+    self->channel_->Rearm();
+    self->internalResume();
+  });
+}
+
+void TcpConnection::internalResume() {
+  std::vector<Task> tasks;
+  while (true) {
+    {
+      std::unique_lock lock(mu_);
+      if (deferred_.empty()) {
+        migrating_ = false;
+        return;
+      }
+      tasks.swap(deferred_);
+    }
+    for (Task& task : tasks) {
+      task();
+    }
+    tasks.clear();
+  }
 }
 
 void TcpConnection::handleSend(std::string_view buffer) {
@@ -121,10 +268,12 @@ void TcpConnection::handleSend(std::string_view buffer) {
   if (!output_.ReadableBytes() && !buffer.empty()) {
     ssize_t w = channel_->Write(buffer.data(), buffer.size());
     if (w < 0) {
-      auto err = channel_->GetError();
+      auto err = Error{errno};
       if (err.GetCode() != EWOULDBLOCK && err.GetCode() != EAGAIN) {
         handleError(err);
       }
+    } else {
+      traffic_.fetch_add(w, std::memory_order_relaxed);
     }
     buffer = buffer.substr(w < 0 ? 0 : w);
   }
@@ -147,10 +296,9 @@ void TcpConnection::ForceClose() {
   }
   state_ = State::kDisconnected;
 
-  auto self = shared_from_this();
-  eventloop_.Run([=] {
+  internalRun([this, self = shared_from_this()] {
     PEDRONET_TRACE("{}::Close()", *this);
-    eventloop_.Remove(channel_, [=] { handleRemove(); });
+    eventloop_.load()->Remove(channel_, [this] { handleRemove(); });
   });
 }
 
@@ -160,8 +308,7 @@ void TcpConnection::Shutdown() {
     return;
   }
 
-  auto self = shared_from_this();
-  eventloop_.Run([=] {
+  internalRun([this, self = shared_from_this()] {
     if (output_.ReadableBytes() == 0) {
       PEDRONET_TRACE("{}::Close()", *this);
       channel_->SetWritable(false);
@@ -176,8 +323,7 @@ void TcpConnection::ForceShutdown() {
   }
   state_ = State::kDisconnecting;
 
-  auto self = shared_from_this();
-  eventloop_.Run([=] {
+  internalRun([this, self = shared_from_this()] {
     PEDRONET_TRACE("{}::Close()", *this);
     channel_->SetWritable(false);
     channel_->CloseWrite();
@@ -192,7 +338,7 @@ void TcpConnection::handleClose() {
   state_ = State::kDisconnected;
 
   auto self = shared_from_this();
-  eventloop_.Remove(channel_, [=] { handleRemove(); });
+  eventloop_.load()->Remove(channel_, [this, self] { handleRemove(); });
 }
 
 void TcpConnection::handleRemove() {
@@ -207,7 +353,7 @@ void TcpConnection::handleRemove() {
 }
 
 void TcpConnection::Send(ArrayBuffer* buf) {
-  if (EventLoop::GetEventLoop() == &eventloop_) {
+  if (internalOwned()) {
     if (buf == &output_) {
       if (output_.ReadableBytes()) {
         channel_->SetWritable(true);
@@ -223,23 +369,24 @@ void TcpConnection::Send(ArrayBuffer* buf) {
 
   std::string clone(buf->ReadIndex(), buf->ReadableBytes());
   buf->Reset();
-  eventloop_.Schedule([self = shared_from_this(),
-                          clone = std::move(clone)]() { self->Send(clone); });
+  internalRun([self = shared_from_this(), clone = std::move(clone)] {
+    self->handleSend(clone);
+  });
 }
 
 void TcpConnection::Send(std::string_view buffer) {
-  if (EventLoop::GetEventLoop() == &eventloop_) {
+  if (internalOwned()) {
     handleSend(buffer);
     return;
   }
 
-  eventloop_.Run([self = shared_from_this(), clone = std::string(buffer)] {
+  internalRun([self = shared_from_this(), clone = std::string(buffer)] {
     self->handleSend(clone);
   });
 }
 
 void TcpConnection::Send(std::string buffer) {
-  eventloop_.Run([self = shared_from_this(), clone = std::move(buffer)] {
+  internalRun([self = shared_from_this(), clone = std::move(buffer)] {
     self->handleSend(clone);
   });
 }
@@ -249,7 +396,7 @@ ArrayBuffer* ChannelContext::GetOutputBuffer() {
 }
 
 ArrayBuffer* ChannelContext::GetInputBuffer() {
-  return conn_ ? &conn_->input_ : nullptr;
+  return conn_ ? conn_->reading_ : nullptr;
 }
 
 }  // namespace pedronet
@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <cstdlib>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include "pedronet/logger/logger.h"
 #include "pedronet/tcp_server.h"
@@ -50,19 +54,93 @@ void TcpServer::Start() {
     PEDRONET_TRACE("TcpServer::OnAccept({})", socket);
     socket.SetOptions(options_.child_options);
 
-    auto conn = std::make_shared<TcpConnection>(worker_group_->Next(),
-                                                std::move(socket));
+    auto& loop = worker_group_->Next(options_.placement);
+    auto conn = std::make_shared<TcpConnection>(loop, std::move(socket));
     conn->SetHandler(std::make_shared<TcpServerChannelHandler>(
         conn->GetChannelContext(), this));
+    conn->SetTrigger(options_.child_options.trigger);
     conn->Start();
   });
 
   acceptor_->Listen();
+
+  Duration interval = options_.rebalance_interval;
+  if (interval > Duration::Zero()) {
+    rebalance_timer_ = boss_group_->ScheduleEvery(
+        interval, interval, [this] { internalRebalance(); });
+  }
   PEDRONET_TRACE("TcpServer::Start() exit");
 }
 
+void TcpServer::internalRebalance() {
+  size_t n = worker_group_->Size();
+  std::unordered_map<EventLoop*, size_t> index;
+  for (size_t i = 0; i < n; ++i) {
+    index[&worker_group_->GetLoop(i)] = i;
+  }
+
+  // The traffic of every connection since the last round, grouped by loop.
+  using Load = std::pair<uint64_t, TcpConnection::Ptr>;
+  std::vector<std::vector<Load>> conns(n);
+  std::vector<uint64_t> loads(n);
+  {
+    std::unique_lock lock(mu_);
+    for (auto& conn : conns_) {
+      auto it = index.find(&conn->GetEventLoop());
+      if (it == index.end()) {
+        continue;
+      }
+      uint64_t traffic = conn->TakeTraffic();
+      loads[it->second] += traffic;
+      conns[it->second].emplace_back(traffic, conn);
+    }
+  }
+
+  for (size_t round = 0; round < n; ++round) {
+    auto hot = std::max_element(loads.begin(), loads.end()) - loads.begin();
+    auto cold = std::min_element(loads.begin(), loads.end()) - loads.begin();
+    if (loads[hot] <= options_.rebalance_ratio * loads[cold]) {
+      return;
+    }
+
+    // Moving a connection with traffic t turns the gap into |gap - 2t|, the
+    // best candidate is the one closest to half of the gap.
+    uint64_t gap = loads[hot] - loads[cold];
+    auto& candidates = conns[hot];
+    auto best = candidates.end();
+    for (auto it = candidates.begin(); it != candidates.end(); ++it) {
+      if (it->first == 0 || it->first >= gap) {
+        continue;
+      }
+      if (best == candidates.end() ||
+          std::abs((int64_t)(gap - 2 * it->first)) <
+              std::abs((int64_t)(gap - 2 * best->first))) {
+        best = it;
+      }
+    }
+    if (best == candidates.end()) {
+      return;
+    }
+
+    Load load = std::move(*best);
+    candidates.erase(best);
+    if (!load.second->Migrate(worker_group_->GetLoop(cold))) {
+      continue;
+    }
+    PEDRONET_INFO("migrate {} from loop {} to loop {}", *load.second, hot,
+                  cold);
+    loads[hot] -= load.first;
+    loads[cold] += load.first;
+    conns[cold].emplace_back(std::move(load));
+  }
+}
+
 void TcpServer::Close() {
   PEDRONET_TRACE("TcpServer::Close() enter");
+  if (rebalance_timer_ != 0) {
+    boss_group_->ScheduleCancel(rebalance_timer_);
+    rebalance_timer_ = 0;
+  }
   acceptor_->Close();
 
   std::unique_lock<std::mutex> lock(mu_);
@@ -0,0 +1,108 @@
+#include "pedronet/watchdog.h"
+#include "pedronet/eventloop.h"
+#include "pedronet/logger/logger.h"
+
+#include <cxxabi.h>
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+
+namespace pedronet {
+
+static std::string Demangle(const std::type_info& type) {
+  int status = 0;
+  std::unique_ptr<char, decltype(&std::free)> name(
+      abi::__cxa_demangle(type.name(), nullptr, nullptr, &status), &std::free);
+  return status == 0 ? name.get() : type.name();
+}
+
+static std::string Culprit(const LoopActivity& activity) {
+  std::string culprit;
+  if (auto task = activity.task.load(std::memory_order_relaxed)) {
+    culprit = fmt::format("task {}", Demangle(*task));
+  }
+
+  auto channel = activity.channel.load(std::memory_order_relaxed);
+  if (channel != nullptr) {
+    culprit += fmt::format("{}{}[fd={}]", culprit.empty() ? "" : " in ",
+                           Demangle(*channel),
+                           activity.fd.load(std::memory_order_relaxed));
+  }
+  if (!culprit.empty()) {
+    return culprit;
+  }
+
+  switch (activity.stage.load(std::memory_order_relaxed)) {
+    case LoopActivity::Stage::kDispatch:
+      return "dispatching events";
+    case LoopActivity::Stage::kDrain:
+      return "draining tasks";
+    case LoopActivity::Stage::kTimers:
+      return "processing timers";
+    default:
+      return "the loop";
+  }
+}
+
+Watchdog::Watchdog(std::vector<EventLoop*> loops,
+                   const EventLoopOptions& options)
+    : loops_(std::move(loops)),
+      threshold_(options.stall_threshold),
+      callback_(options.stall_callback),
+      reported_(loops_.size()) {
+  thread_ = std::thread([this] { internalRun(); });
+}
+
+void Watchdog::internalRun() {
+  // A stall is reported at most a quarter of the threshold late.
+  auto period = std::chrono::microseconds(
+      std::max<int64_t>(threshold_.Microseconds() / 4, 1000));
+
+  std::unique_lock lock(mu_);
+  while (!cv_.wait_for(lock, period, [this] { return stopped_; })) {
+    uint64_t now = LoopMetrics::Now();
+    for (size_t i = 0; i < loops_.size(); ++i) {
+      internalCheck(i, now);
+    }
+  }
+}
+
+void Watchdog::internalCheck(size_t index, uint64_t now) {
+  const LoopActivity& activity = loops_[index]->GetActivity();
+  if (activity.stage.load(std::memory_order_relaxed) ==
+      LoopActivity::Stage::kWait) {
+    return;
+  }
+
+  uint64_t since = activity.busy_since.load(std::memory_order_relaxed);
+  uint64_t threshold = threshold_.Microseconds() * 1000;
+  if (since == 0 || since == reported_[index] || now < since + threshold) {
+    return;
+  }
+  reported_[index] = since;
+
+  StallReport report;
+  report.loop = index;
+  report.stalled = Duration::Microseconds((now - since) / 1000);
+  report.culprit = Culprit(activity);
+  if (callback_) {
+    callback_(report);
+    return;
+  }
+  PEDRONET_WARN("event loop {} stalled for {}ms in {}", report.loop,
+                report.stalled.Milliseconds(), report.culprit);
+}
+
+void Watchdog::Stop() {
+  std::unique_lock lock(mu_);
+  stopped_ = true;
+  cv_.notify_all();
+}
+
+void Watchdog::Join() {
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+}  // namespace pedronet
@@ -0,0 +1,218 @@
+#include "pedronet/worker_pool.h"
+
+namespace pedronet {
+
+WorkerPool::Current& WorkerPool::current() noexcept {
+  thread_local Current current;
+  return current;
+}
+
+WorkerPool::WorkerPool(size_t threads) : workers_(threads) {}
+
+WorkerPool::Ptr WorkerPool::Create(size_t threads) {
+  auto pool = std::make_shared<WorkerPool>(threads);
+  pool->timer_group_ = EventLoopGroup::Create(1);
+  for (size_t i = 0; i < threads; ++i) {
+    pool->threads_.emplace_back([pool = pool.get(), i] {
+      pool->internalRun(i);
+    });
+  }
+  return pool;
+}
+
+void WorkerPool::Completions::Add(Task task) {
+  bool first;
+  {
+    std::unique_lock lock(mu);
+    first = tasks.empty();
+    tasks.emplace_back(std::move(task));
+  }
+
+  // The loop already has a drain pending otherwise.
+  if (!first ||
+      loop->Schedule([self = shared_from_this()] { self->Drain(); })) {
+    return;
+  }
+
+  size_t dropped;
+  {
+    std::unique_lock lock(mu);
+    dropped = tasks.size();
+    tasks.clear();
+  }
+  PEDRONET_WARN("WorkerPool dropped {} continuations of a closed EventLoop",
+                dropped);
+}
+
+void WorkerPool::Completions::Drain() {
+  {
+    std::unique_lock lock(mu);
+    running.swap(tasks);
+  }
+  for (Task& task : running) {
+    task();
+  }
+  running.clear();
+}
+
+std::shared_ptr<WorkerPool::Completions> WorkerPool::internalCompletions(
+    EventLoop& loop) {
+  // A loop usually submits to the same pool over and over. A loop allocated
+  // where a destroyed one was finds the entry of the old one closed.
+  struct Cached {
+    uint64_t pool{};
+    EventLoop* loop{};
+    std::shared_ptr<Completions> completions;
+  };
+  thread_local Cached cached;
+  if (cached.pool == id_ && cached.loop == &loop &&
+      !cached.completions->loop->Closed()) {
+    return cached.completions;
+  }
+
+  std::unique_lock lock(completions_mu_);
+  auto it = completions_.find(&loop);
+  if (it == completions_.end() || it->second->loop->Closed()) {
+    // Entries are only added for new loops, the closed ones go then.
+    for (it = completions_.begin(); it != completions_.end();) {
+      if (it->second->loop->Closed()) {
+        it = completions_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    auto completions = std::make_shared<Completions>(loop.GetHandle());
+    it = completions_.emplace(&loop, std::move(completions)).first;
+  }
+  cached = Cached{id_, &loop, it->second};
+  return it->second;
+}
+
+bool WorkerPool::internalPush(Task task) {
+  // Counted before the closed_ check: a worker which finds the pool closed
+  // and nothing pending has stopped for good, and then this push sees
+  // closed_. The workers themselves still spawn tasks after Close().
+  Current& self = current();
+  pending_.fetch_add(1);
+  if (self.pool != this && closed_) {
+    pending_.fetch_sub(1);
+    return false;
+  }
+
+  // A worker keeps the tasks it spawns, the others steal them if idle.
+  size_t index = self.pool == this
+                     ? self.index
+                     : next_.fetch_add(1, std::memory_order_relaxed) %
+                           workers_.size();
+  {
+    std::unique_lock lock(workers_[index].mu);
+    workers_[index].tasks.emplace_back(std::move(task));
+  }
+
+  // Pairs with a worker announcing itself before it checks pending_.
+  if (sleepers_.load() != 0) {
+    std::unique_lock lock(mu_);
+    cv_.notify_one();
+  }
+  return true;
+}
+
+void WorkerPool::internalSchedule(Task task) {
+  if (!internalPush(std::move(task))) {
+    PEDRONET_FATAL("WorkerPool is closed, no worker would run the task");
+  }
+}
+
+bool WorkerPool::internalPop(size_t index, Task& task) {
+  Worker& worker = workers_[index];
+  std::unique_lock lock(worker.mu);
+  if (worker.tasks.empty()) {
+    return false;
+  }
+  task = std::move(worker.tasks.back());
+  worker.tasks.pop_back();
+  return true;
+}
+
+bool WorkerPool::internalSteal(size_t index, Task& task) {
+  for (size_t i = 1; i < workers_.size(); ++i) {
+    Worker& victim = workers_[(index + i) % workers_.size()];
+    std::unique_lock lock(victim.mu);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool WorkerPool::internalNext(size_t index, Task& task) {
+  while (true) {
+    if (internalPop(index, task) || internalSteal(index, task)) {
+      pending_.fetch_sub(1);
+      return true;
+    }
+
+    std::unique_lock lock(mu_);
+    if (closed_ && pending_ == 0) {
+      return false;
+    }
+    sleepers_.fetch_add(1);
+    cv_.wait(lock, [this] { return pending_ != 0 || closed_; });
+    sleepers_.fetch_sub(1);
+  }
+}
+
+void WorkerPool::internalRun(size_t index) {
+  current() = Current{this, index};
+  Task task;
+  while (internalNext(index, task)) {
+    task();
+    task = nullptr;
+  }
+}
+
+uint64_t WorkerPool::ScheduleAfter(Duration delay, Callback cb) {
+  // A timer firing while the pool closes is dropped.
+  return timer_group_->ScheduleAfter(
+      delay, [this, cb = std::move(cb)] { internalPush(Task{cb}); });
+}
+
+uint64_t WorkerPool::ScheduleEvery(Duration delay, Duration interval,
+                                   Callback cb) {
+  return timer_group_->ScheduleEvery(
+      delay, interval, [this, cb = std::move(cb)] { internalPush(Task{cb}); });
+}
+
+void WorkerPool::ScheduleCancel(uint64_t id) {
+  timer_group_->ScheduleCancel(id);
+}
+
+void WorkerPool::Close() {
+  if (timer_group_ != nullptr) {
+    timer_group_->Close();
+  }
+
+  std::unique_lock lock(mu_);
+  closed_ = true;
+  cv_.notify_all();
+}
+
+void WorkerPool::Join() {
+  HandleJoin();
+  if (timer_group_ != nullptr) {
+    timer_group_->Join();
+  }
+}
+
+void WorkerPool::HandleJoin() {
+  for (auto& t : threads_) {
+    if (t.joinable()) {
+      t.join();
+    }
+  }
+  threads_.clear();
+}
+
+}  // namespace pedronet
@@ -0,0 +1,26 @@
+#ifndef PEDRONET_TEST_CHECK_H
+#define PEDRONET_TEST_CHECK_H
+
+#include <cstdio>
+
+namespace pedronet::test {
+
+// The tests are plain executables run by ctest, every failed CHECK() is
+// reported and turns the exit code of main() non-zero.
+inline int& Failures() {
+  static int failures = 0;
+  return failures;
+}
+
+}  // namespace pedronet::test
+
+#define CHECK(cond)                                                      \
+  do {                                                                   \
+    if (!(cond)) {                                                       \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__,        \
+                   __LINE__, #cond);                                     \
+      ++pedronet::test::Failures();                                      \
+    }                                                                    \
+  } while (0)
+
+#endif  // PEDRONET_TEST_CHECK_H
@@ -0,0 +1,116 @@
+#include <pedronet/queue/event_queue_factory.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+
+using pedronet::EventChannel;
+using pedronet::EventQueueType;
+using pedronet::EventSpscMeshQueue;
+
+// Every producer adds count tasks, and the tasks of a producer run in the
+// order they were added. The consumer runs concurrently unless the producers
+// fill the queue up first, which overflows the rings of the mesh queue.
+static void TestProducerOrder(EventQueueType type, size_t producers,
+                              size_t count, bool concurrent) {
+  EventChannel channel;
+  auto queue = pedronet::MakeEventQueue(type, &channel);
+
+  // Only touched by the tasks, which run on the consumer.
+  std::vector<size_t> next(producers);
+  size_t ran = 0;
+  size_t bad = 0;
+
+  std::atomic_size_t done{0};
+  std::vector<std::thread> threads;
+  for (size_t p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p] {
+      for (size_t i = 0; i < count; ++i) {
+        queue->Add([&, p, i] {
+          bad += next[p] != i;
+          next[p] = i + 1;
+          ran++;
+        });
+      }
+      done++;
+    });
+  }
+
+  if (!concurrent) {
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  // A small budget leaves tasks of the rings and the overflow lists behind
+  // on every call.
+  while (done != producers || !queue->Empty()) {
+    queue->Process(37);
+  }
+  if (concurrent) {
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  queue->Process();
+
+  CHECK(ran == producers * count);
+  CHECK(bad == 0);
+}
+
+static void TestMeshSize() {
+  EventChannel channel;
+  EventSpscMeshQueue queue(&channel);
+
+  // 1000 spill over the ring of the producer, 10 go to another ring.
+  std::thread([&] {
+    for (int i = 0; i < 1000; ++i) {
+      queue.Add([] {});
+    }
+  }).join();
+  for (int i = 0; i < 10; ++i) {
+    queue.Add([] {});
+  }
+  CHECK(queue.Size() == 1010);
+  CHECK(!queue.Empty());
+
+  CHECK(queue.Process(500) == 500);
+  CHECK(queue.Size() == 510);
+  CHECK(queue.Process() == 510);
+  CHECK(queue.Size() == 0);
+  CHECK(queue.Empty());
+}
+
+// A thread keeps its mailbox slots across queues: the slot of a destroyed
+// queue is reused by the next one and must not deliver to the old ring.
+static void TestMeshSlotReuse() {
+  EventChannel channel;
+  for (int i = 0; i < 1000; ++i) {
+    int ran = 0;
+    {
+      EventSpscMeshQueue old(&channel);
+      old.Add([&] { ran += 100; });
+    }
+    EventSpscMeshQueue queue(&channel);
+    queue.Add([&] { ran++; });
+    CHECK(queue.Size() == 1);
+    queue.Process();
+    CHECK(ran == 1);
+  }
+}
+
+int main() {
+  for (auto type : {EventQueueType::kBlockingQueue,
+                    EventQueueType::kDoubleBufferQueue,
+                    EventQueueType::kLockFreeQueue,
+                    EventQueueType::kSpscMesh}) {
+    TestProducerOrder(type, 8, 5000, false);
+    TestProducerOrder(type, 8, 5000, true);
+    // More producers than the mesh queue has rings.
+    TestProducerOrder(type, 80, 500, true);
+  }
+  TestMeshSize();
+  TestMeshSlotReuse();
+  return pedronet::test::Failures() == 0 ? 0 : 1;
+}
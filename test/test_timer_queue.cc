@@ -0,0 +1,284 @@
+#include <pedronet/queue/timer_hash_wheel.h>
+#include <pedronet/queue/timer_heap_queue.h>
+#include <pedronet/queue/timer_wheel.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+
+using namespace std::chrono_literals;
+using pedronet::Duration;
+using pedronet::TimerChannel;
+using pedronet::TimerHashWheel;
+using pedronet::TimerHeapQueue;
+using pedronet::TimerQueue;
+using pedronet::TimerWheel;
+using pedronet::Timestamp;
+
+struct QueueType {
+  const char* name;
+  // Timers due within the same tick may fire in any order.
+  Duration tick;
+  // The deadline is rounded down to the tick, so a timer may fire early.
+  bool early;
+  std::function<std::unique_ptr<TimerQueue>(TimerChannel*)> make;
+};
+
+static std::vector<QueueType> QueueTypes() {
+  return {
+      {"TimerHeapQueue", Duration::Zero(), false,
+       [](TimerChannel* channel) {
+         return std::make_unique<TimerHeapQueue>(channel);
+       }},
+      {"TimerWheel", Duration::Milliseconds(1), false,
+       [](TimerChannel* channel) {
+         return std::make_unique<TimerWheel>(channel);
+       }},
+      // Few buckets, so the timers below take several rounds.
+      {"TimerHashWheel", Duration::Milliseconds(1), true,
+       [](TimerChannel* channel) {
+         TimerHashWheel::Options options;
+         options.tick = Duration::Milliseconds(1);
+         options.buckets = 64;
+         return std::make_unique<TimerHashWheel>(channel, options);
+       }},
+  };
+}
+
+// Processes until the duration has passed and once after that, so every
+// timer due within it has been processed however late the thread woke up.
+static void ProcessFor(TimerQueue& queue, Duration duration) {
+  Timestamp end = Timestamp::Now() + duration;
+  while (Timestamp::Now() < end) {
+    queue.Process();
+    std::this_thread::sleep_for(100us);
+  }
+  queue.Process();
+}
+
+// Processes until done() holds. The timeout is far beyond the delays of the
+// tests, it only keeps a broken queue from hanging them.
+template <typename Done>
+static bool ProcessUntil(TimerQueue& queue, Done&& done) {
+  Timestamp end = Timestamp::Now() + Duration::Seconds(10);
+  while (!done()) {
+    if (Timestamp::Now() >= end) {
+      return false;
+    }
+    queue.Process();
+    std::this_thread::sleep_for(100us);
+  }
+  return true;
+}
+
+static uint64_t Add(TimerQueue& queue, Duration delay,
+                    std::function<void()> callback) {
+  return queue.Add(delay, Duration::Zero(), Duration::Zero(),
+                   std::move(callback));
+}
+
+static void TestOrdering(const QueueType& type) {
+  TimerChannel channel;
+  auto queue = type.make(&channel);
+
+  std::vector<int64_t> delays(200);
+  std::iota(delays.begin(), delays.end(), 0);
+  std::shuffle(delays.begin(), delays.end(), std::mt19937_64{42});
+
+  int64_t tick = type.tick.Microseconds();
+  std::vector<int64_t> fired;
+  for (int64_t ms : delays) {
+    Duration delay = Duration::Milliseconds(ms);
+    int64_t deadline = (Timestamp::Now() + delay).usecs;
+    Add(*queue, delay, [&, deadline] {
+      int64_t early = type.early ? tick : 0;
+      CHECK(Timestamp::Now().usecs + early >= deadline);
+      fired.push_back(deadline);
+    });
+  }
+  CHECK(ProcessUntil(*queue, [&] { return fired.size() == delays.size(); }));
+  for (size_t i = 1; i < fired.size(); ++i) {
+    CHECK(fired[i] + tick >= fired[i - 1]);
+  }
+}
+
+static void TestCancelBeforeFire(const QueueType& type) {
+  TimerChannel channel;
+  auto queue = type.make(&channel);
+
+  std::vector<int> fired(20);
+  int total = 0;
+  for (int i = 0; i < 20; ++i) {
+    uint64_t id = Add(*queue, Duration::Milliseconds(5), [&, i] {
+      fired[i]++;
+      total++;
+    });
+    if (i % 2 == 0) {
+      queue->Cancel(id);
+    }
+  }
+  // The cancelled ones were due together with the others.
+  CHECK(ProcessUntil(*queue, [&] { return total >= 10; }));
+  ProcessFor(*queue, Duration::Milliseconds(5));
+
+  for (int i = 0; i < 20; ++i) {
+    CHECK(fired[i] == i % 2);
+  }
+}
+
+// The ids of fired and cancelled timers are stale, even once their entries
+// hold other timers.
+static void TestStaleIds(const QueueType& type) {
+  TimerChannel channel;
+  auto queue = type.make(&channel);
+
+  bool fired = false;
+  uint64_t id = Add(*queue, Duration::Zero(), [&] { fired = true; });
+  CHECK(ProcessUntil(*queue, [&] { return fired; }));
+  queue->Cancel(id);
+
+  uint64_t cancelled = Add(*queue, Duration::Milliseconds(2), [] {});
+  queue->Cancel(cancelled);
+
+  int reused = 0;
+  for (int i = 0; i < 8; ++i) {
+    uint64_t next = Add(*queue, Duration::Milliseconds(2), [&] { reused++; });
+    CHECK(next != id);
+    CHECK(next != cancelled);
+  }
+  queue->Cancel(id);
+  queue->Cancel(cancelled);
+  CHECK(ProcessUntil(*queue, [&] { return reused == 8; }));
+}
+
+static void TestCancelInCallback(const QueueType& type) {
+  TimerChannel channel;
+  auto queue = type.make(&channel);
+
+  int ticks = 0;
+  uint64_t periodic = queue->Add(
+      Duration::Zero(), Duration::Milliseconds(1), Duration::Zero(), [&] {
+        if (++ticks == 5) {
+          queue->Cancel(periodic);
+        }
+      });
+
+  // Both are due in the same Process(), whichever runs first cancels the
+  // other one.
+  int fired = 0;
+  uint64_t a = 0;
+  uint64_t b = 0;
+  a = Add(*queue, Duration::Milliseconds(2), [&] {
+    fired++;
+    queue->Cancel(b);
+  });
+  b = Add(*queue, Duration::Milliseconds(2), [&] {
+    fired++;
+    queue->Cancel(a);
+  });
+  std::this_thread::sleep_for(5ms);
+  CHECK(ProcessUntil(*queue, [&] { return ticks >= 5 && fired >= 1; }));
+  ProcessFor(*queue, Duration::Milliseconds(5));
+
+  CHECK(ticks == 5);
+  CHECK(fired == 1);
+}
+
+static void TestSlack(const QueueType& type) {
+  TimerChannel channel;
+  auto queue = type.make(&channel);
+
+  Duration delay = Duration::Milliseconds(2);
+  Duration slack = Duration::Milliseconds(10);
+  Timestamp deadline = Timestamp::Now() + delay;
+  Timestamp fired;
+  bool done = false;
+  queue->Add(delay, Duration::Zero(), slack, [&] {
+    fired = Timestamp::Now();
+    done = true;
+  });
+  CHECK(ProcessUntil(*queue, [&] { return done; }));
+
+  int64_t late = (fired - deadline).Microseconds();
+  int64_t early = type.early ? type.tick.Microseconds() : 0;
+  CHECK(late + early >= 0);
+  // Only catches a slack applied way off, a loaded machine wakes up late.
+  Duration bound = slack + type.tick + Duration::Milliseconds(500);
+  CHECK(late <= bound.Microseconds());
+}
+
+// Timers added and cancelled by other threads while the owner processes.
+static void TestStaged(const QueueType& type) {
+  TimerChannel channel;
+  auto queue = type.make(&channel);
+
+  const int threads = 4;
+  const int timers = 500;
+  std::atomic_int fired{0};
+  std::atomic_int cancelled{0};
+  std::atomic_int done{0};
+  std::vector<std::thread> producers;
+  for (int t = 0; t < threads; ++t) {
+    producers.emplace_back([&] {
+      // The ones to cancel are due late enough for the cancel to get there
+      // first, even if the producer is descheduled in between.
+      for (int i = 0; i < timers; ++i) {
+        bool cancel = i % 2 == 0;
+        Duration delay = Duration::Milliseconds(cancel ? 500 : 5);
+        uint64_t id = queue->Stage(
+            delay, Duration::Zero(), Duration::Zero(),
+            [&, cancel] { (cancel ? cancelled : fired)++; });
+        if (cancel) {
+          queue->StageCancel(id);
+        }
+      }
+      done++;
+    });
+  }
+  while (done != threads) {
+    ProcessFor(*queue, Duration::Milliseconds(1));
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  CHECK(ProcessUntil(*queue, [&] { return fired == threads * timers / 2; }));
+  ProcessFor(*queue, Duration::Milliseconds(600));
+
+  CHECK(fired == threads * timers / 2);
+  CHECK(cancelled == 0);
+
+  // The owner cancels a timer still waiting in the stack.
+  bool ran = false;
+  uint64_t id = 0;
+  std::thread([&] {
+    id = queue->Stage(Duration::Milliseconds(1), Duration::Zero(),
+                      Duration::Zero(), [&] { ran = true; });
+  }).join();
+  queue->Cancel(id);
+
+  // Another thread cancels a timer of the owner.
+  uint64_t owned = Add(*queue, Duration::Milliseconds(5), [&] { ran = true; });
+  std::thread([&] { queue->StageCancel(owned); }).join();
+  ProcessFor(*queue, Duration::Milliseconds(20));
+  CHECK(!ran);
+}
+
+int main() {
+  for (const QueueType& type : QueueTypes()) {
+    std::fprintf(stderr, "%s\n", type.name);
+    TestOrdering(type);
+    TestCancelBeforeFire(type);
+    TestStaleIds(type);
+    TestCancelInCallback(type);
+    TestSlack(type);
+    TestStaged(type);
+  }
+  return pedronet::test::Failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#include <pedronet/eventloopgroup.h>
+#include <pedronet/worker_pool.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include "check.h"
+
+using namespace std::chrono_literals;
+using pedronet::EventLoop;
+using pedronet::EventLoopGroup;
+using pedronet::WorkerPool;
+
+// Close() stops taking new work but the tasks already queued, and the tasks
+// they spawn, still run before Join() returns.
+static void TestCloseRunsQueued() {
+  auto pool = WorkerPool::Create(4);
+
+  const int tasks = 10000;
+  std::atomic_int ran{0};
+  std::atomic_int spawned{0};
+  for (int i = 0; i < tasks; ++i) {
+    pool->Schedule([&, i] {
+      // Keep the workers busy, so most tasks are still queued on Close().
+      if (i % 100 == 0) {
+        std::this_thread::sleep_for(100us);
+      }
+      if (i % 10 == 0) {
+        pool->Schedule([&] { spawned++; });
+      }
+      ran++;
+    });
+  }
+  pool->Close();
+  pool->Join();
+
+  CHECK(ran == tasks);
+  CHECK(spawned == tasks / 10);
+  CHECK(pool->Size() == 0);
+}
+
+// The continuations run on the loop that submitted the work.
+static void TestSubmit() {
+  auto group = EventLoopGroup::Create(2);
+  auto pool = WorkerPool::Create(4);
+
+  const int tasks = 1000;
+  std::atomic_int wrong{0};
+  std::atomic_int sum{0};
+  std::atomic_int done{0};
+  std::promise<void> finished;
+  for (int i = 0; i < tasks; ++i) {
+    EventLoop& loop = group->Next();
+    loop.Schedule([&, i] {
+      EventLoop* submitter = EventLoop::GetEventLoop();
+      pool->Submit([i] { return i; },
+                   [&, submitter](int result) {
+                     wrong += EventLoop::GetEventLoop() != submitter;
+                     sum += result;
+                     if (++done == tasks) {
+                       finished.set_value();
+                     }
+                   });
+    });
+  }
+  CHECK(finished.get_future().wait_for(10s) == std::future_status::ready);
+  CHECK(wrong == 0);
+  CHECK(sum == tasks * (tasks - 1) / 2);
+
+  pool->Close();
+  pool->Join();
+  group->Close();
+  group->Join();
+}
+
+// Work finishing after its loop is gone drops the continuation, and a loop
+// created later, possibly at the same address, still gets its own.
+static void TestSubmitClosedLoop() {
+  // A single worker runs the work of an iteration in order.
+  auto pool = WorkerPool::Create(1);
+
+  for (int i = 0; i < 20; ++i) {
+    std::atomic_bool dropped{true};
+    std::promise<void> gone;
+    {
+      auto group = EventLoopGroup::Create(1);
+      std::promise<void> submitted;
+      group->Next().Schedule([&] {
+        pool->Submit([&] { gone.get_future().wait(); },
+                     [&] { dropped = false; });
+        submitted.set_value();
+      });
+      submitted.get_future().wait();
+      group->Close();
+      group->Join();
+    }
+    gone.set_value();
+
+    auto group = EventLoopGroup::Create(1);
+    std::promise<void> finished;
+    group->Next().Schedule([&] {
+      pool->Submit([] {}, [&] { finished.set_value(); });
+    });
+    CHECK(finished.get_future().wait_for(10s) == std::future_status::ready);
+    CHECK(dropped);
+    group->Close();
+    group->Join();
+  }
+
+  pool->Close();
+  pool->Join();
+}
+
+int main() {
+  TestCloseRunsQueued();
+  TestSubmit();
+  TestSubmitClosedLoop();
+  return pedronet::test::Failures() == 0 ? 0 : 1;
+}